@@ -42,4 +42,16 @@ void AbstractProtocol::SetSetTimeCallback(
   set_time_callback_ = callback;
 }
 
+void AbstractProtocol::SetSetMemoryCallback(
+  std::function<void(int32_t)> callback
+) {
+  set_memory_callback_ = callback;
+}
+
+void AbstractProtocol::SetSetCoresCallback(
+  std::function<void(int32_t)> callback
+) {
+  set_cores_callback_ = callback;
+}
+
 }  // namespace chess_engine
@@ -43,6 +43,8 @@ class AbstractProtocol {
   void SetSetModeCallback(std::function<void(EngineMode)> callback);
   void SetSetBoardCallback(std::function<void(const Position&)> callback);
   void SetSetTimeCallback(std::function<void(TimeControl)> callback);
+  void SetSetMemoryCallback(std::function<void(int32_t)> callback);
+  void SetSetCoresCallback(std::function<void(int32_t)> callback);
 
  protected:
   std::function<void()> new_game_callback_;
@@ -52,6 +54,8 @@ class AbstractProtocol {
   std::function<void(EngineMode)> set_mode_callback_;
   std::function<void(Position)> set_board_callback_;
   std::function<void(TimeControl)> set_time_callback_;
+  std::function<void(int32_t)> set_memory_callback_;  // In megabytes.
+  std::function<void(int32_t)> set_cores_callback_;
 };
 
 }  // namespace chess_engine
@@ -0,0 +1,113 @@
+#include "src/bitboard.h"
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "src/chess_defines.h"
+
+namespace chess_engine {
+namespace internal {
+
+namespace {
+
+const std::array<Coordinates, 4> kRookDeltas = {
+  Coordinates{0, 1}, {1, 0}, {0, -1}, {-1, 0}
+};
+const std::array<Coordinates, 4> kBishopDeltas = {
+  Coordinates{1, 1}, {1, -1}, {-1, -1}, {-1, 1}
+};
+
+// Walks the rays square by square. Only used to fill the tables.
+Bitboard SlidingAttacks(
+  int8_t square,
+  Bitboard occupied,
+  const std::array<Coordinates, 4>& deltas
+) {
+  Bitboard ret = 0;
+  for (Coordinates delta : deltas) {
+    Coordinates current = IndexToCoordinates(square);
+    current += delta;
+    while (WithinTheBoard(current)) {
+      ret |= SquareBitboard(current);
+      if (occupied & SquareBitboard(current)) {
+        break;
+      }
+      current += delta;
+    }
+  }
+  return ret;
+}
+
+// Finds magic numbers by trial and error. A fixed seed makes the
+// tables the same on every run.
+void InitMagics(
+  const std::array<Coordinates, 4>& deltas,
+  std::array<Magic, 64>* magics,
+  std::vector<Bitboard>* attacks
+) {
+  std::mt19937_64 generator(2718281828459045235ull);
+  std::vector<Bitboard> occupancies;
+  std::vector<Bitboard> references;
+  std::vector<int> used_in_attempt;
+  uint32_t offset = 0;
+  for (int8_t square = 0; square < 64; ++square) {
+    Coordinates coordinates = IndexToCoordinates(square);
+    // Pieces on the edges don't block anything.
+    Bitboard edges =
+      ((kRank1 | kRank8) & ~(kRank1 << 8*coordinates.rank)) |
+      ((kFileA | kFileH) & ~(kFileA << coordinates.file));
+    Magic& magic = (*magics)[square];
+    magic.mask = SlidingAttacks(square, 0, deltas) & ~edges;
+    magic.shift = 64 - CountSquares(magic.mask);
+    magic.offset = offset;
+
+    // Enumerate all subsets of the mask (Carry-Rippler trick).
+    occupancies.clear();
+    references.clear();
+    Bitboard subset = 0;
+    do {
+      occupancies.push_back(subset);
+      references.push_back(SlidingAttacks(square, subset, deltas));
+      subset = (subset - magic.mask) & magic.mask;
+    } while (subset);
+
+    size_t size = occupancies.size();
+    attacks->resize(offset + size);
+    used_in_attempt.assign(size, 0);
+    for (int attempt = 1; ; ++attempt) {
+      do {
+        // Sparse numbers make better magics.
+        magic.magic = generator() & generator() & generator();
+      } while (CountSquares((magic.mask*magic.magic) >> 56) < 6);
+
+      bool success = true;
+      for (size_t i = 0; i < size && success; ++i) {
+        uint32_t index = magic.Index(occupancies[i]);
+        if (used_in_attempt[index - offset] != attempt) {
+          used_in_attempt[index - offset] = attempt;
+          (*attacks)[index] = references[i];
+        } else if ((*attacks)[index] != references[i]) {
+          success = false;
+        }
+      }
+      if (success) {
+        break;
+      }
+    }
+    offset += size;
+  }
+}
+
+}  // namespace
+
+MagicTables::MagicTables() {
+  InitMagics(kRookDeltas, &rook_magics, &rook_attacks);
+  InitMagics(kBishopDeltas, &bishop_magics, &bishop_attacks);
+}
+
+const MagicTables kMagicTables;
+
+}  // namespace internal
+}  // namespace chess_engine
@@ -0,0 +1,242 @@
+#ifndef SRC_BITBOARD_H_
+#define SRC_BITBOARD_H_
+
+// Bitboards are 64-bit sets of squares. Square with index
+// rank*8 + file corresponds to the bit with the same index,
+// so a1 is the lowest bit and h8 is the highest one.
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "src/chess_defines.h"
+
+namespace chess_engine {
+
+using Bitboard = uint64_t;
+
+const Bitboard kFileA = 0x0101010101010101ull;
+const Bitboard kFileH = kFileA << 7;
+const Bitboard kRank1 = 0xFFull;
+const Bitboard kRank8 = kRank1 << 56;
+const Bitboard kDarkSquares = 0xAA55AA55AA55AA55ull;
+
+inline int8_t SquareIndex(Coordinates square) {
+  return square.rank*8 + square.file;
+}
+
+inline Coordinates IndexToCoordinates(int8_t index) {
+  return {static_cast<int8_t>(index & 7), static_cast<int8_t>(index >> 3)};
+}
+
+inline Bitboard SquareBitboard(int8_t index) {
+  return 1ull << index;
+}
+
+inline Bitboard SquareBitboard(Coordinates square) {
+  return SquareBitboard(SquareIndex(square));
+}
+
+inline int8_t CountSquares(Bitboard bitboard) {
+  return std::popcount(bitboard);
+}
+
+inline int8_t LowestSquare(Bitboard bitboard) {
+  return std::countr_zero(bitboard);
+}
+
+// Removes the lowest square from the set and returns its index.
+inline int8_t PopLowestSquare(Bitboard* bitboard) {
+  int8_t ret = LowestSquare(*bitboard);
+  *bitboard &= *bitboard - 1;
+  return ret;
+}
+
+// Shifts every square by 'offset' indecies. Positive offsets move squares
+// towards the eighth rank. Wrapping around the board is up to the caller.
+inline Bitboard Shift(Bitboard bitboard, int8_t offset) {
+  return offset > 0 ? bitboard << offset : bitboard >> -offset;
+}
+
+namespace internal {
+
+// Square with given coordinates as a set, empty if it's off the board.
+constexpr Bitboard CoordinatesBitboard(int file, int rank) {
+  if (file < 0 || file >= 8 || rank < 0 || rank >= 8) {
+    return 0;
+  }
+  return 1ull << (rank*8 + file);
+}
+
+// Everything, that only depends on the geometry of the board.
+// Indexed by square indecies.
+struct GeometryTables {
+  std::array<Bitboard, 64> knight_attacks = {};
+  std::array<Bitboard, 64> king_attacks = {};
+  // Indexed by the underlying value of Player.
+  std::array<std::array<Bitboard, 64>, 3> pawn_attacks = {};
+  // Squares strictly between two squares on the same line.
+  std::array<std::array<Bitboard, 64>, 64> between = {};
+  // The entire line, going through two squares, including them.
+  std::array<std::array<Bitboard, 64>, 64> line = {};
+  // The number of king moves between two squares.
+  std::array<std::array<int8_t, 64>, 64> distance = {};
+  // The number of steps to the edge of the board. Indexed by square,
+  // then by file and rank of the step plus one.
+  std::array<std::array<std::array<int8_t, 3>, 3>, 64> squares_to_edge = {};
+};
+
+constexpr GeometryTables MakeGeometryTables() {
+  const int kKnightJumps[8][2] = {
+    {2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}
+  };
+  const int kKingSteps[8][2] = {
+    {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}
+  };
+  GeometryTables ret;
+  for (int square = 0; square < 64; ++square) {
+    int file = square & 7;
+    int rank = square >> 3;
+    for (const auto& jump : kKnightJumps) {
+      ret.knight_attacks[square] |=
+        CoordinatesBitboard(file + jump[0], rank + jump[1]);
+    }
+    for (const auto& step : kKingSteps) {
+      ret.king_attacks[square] |=
+        CoordinatesBitboard(file + step[0], rank + step[1]);
+    }
+    ret.pawn_attacks[static_cast<int>(Player::kWhite)][square] =
+      CoordinatesBitboard(file + 1, rank + 1) |
+      CoordinatesBitboard(file - 1, rank + 1);
+    ret.pawn_attacks[static_cast<int>(Player::kBlack)][square] =
+      CoordinatesBitboard(file + 1, rank - 1) |
+      CoordinatesBitboard(file - 1, rank - 1);
+
+    for (int other = 0; other < 64; ++other) {
+      int file_distance = file - (other & 7);
+      int rank_distance = rank - (other >> 3);
+      file_distance = file_distance < 0 ? -file_distance : file_distance;
+      rank_distance = rank_distance < 0 ? -rank_distance : rank_distance;
+      ret.distance[square][other] =
+        file_distance > rank_distance ? file_distance : rank_distance;
+    }
+
+    for (const auto& step : kKingSteps) {
+      int file_step = step[0];
+      int rank_step = step[1];
+      // Squares in the direction of the step and in the opposite one.
+      Bitboard forward = 0;
+      Bitboard backward = 0;
+      int8_t steps = 0;
+      while (Bitboard next = CoordinatesBitboard(
+        file + (steps + 1)*file_step, rank + (steps + 1)*rank_step
+      )) {
+        forward |= next;
+        ++steps;
+      }
+      ret.squares_to_edge[square][file_step + 1][rank_step + 1] = steps;
+      for (int i = 1; i < 8; ++i) {
+        backward |= CoordinatesBitboard(file - i*file_step, rank - i*rank_step);
+      }
+
+      Bitboard passed = 0;
+      for (int i = 1; i <= steps; ++i) {
+        int other = square + i*(rank_step*8 + file_step);
+        ret.between[square][other] = passed;
+        ret.line[square][other] = forward | backward | (1ull << square);
+        passed |= 1ull << other;
+      }
+    }
+  }
+  return ret;
+}
+
+inline constexpr GeometryTables kGeometryTables = MakeGeometryTables();
+
+// "Fancy" magic bitboards, see
+// https://www.chessprogramming.org/Magic_Bitboards
+struct Magic {
+  Bitboard mask;
+  Bitboard magic;
+  uint32_t offset;  // Offset of the square's attacks in the shared table.
+  uint8_t shift;
+
+  uint32_t Index(Bitboard occupied) const {
+    return offset + static_cast<uint32_t>(((occupied & mask)*magic) >> shift);
+  }
+};
+
+// Magics are found by trial and error, so they are filled once,
+// when the program starts.
+struct MagicTables {
+  MagicTables();
+
+  std::array<Magic, 64> rook_magics;
+  std::array<Magic, 64> bishop_magics;
+  std::vector<Bitboard> rook_attacks;
+  std::vector<Bitboard> bishop_attacks;
+};
+
+extern const MagicTables kMagicTables;
+
+}  // namespace internal
+
+constexpr Bitboard KnightAttacks(int8_t square) {
+  return internal::kGeometryTables.knight_attacks[square];
+}
+
+constexpr Bitboard KingAttacks(int8_t square) {
+  return internal::kGeometryTables.king_attacks[square];
+}
+
+// Squares attacked by a pawn of a 'player', standing on a 'square'.
+constexpr Bitboard PawnAttacks(Player player, int8_t square) {
+  const internal::GeometryTables& tables = internal::kGeometryTables;
+  return tables.pawn_attacks[static_cast<int>(player)][square];
+}
+
+inline Bitboard RookAttacks(int8_t square, Bitboard occupied) {
+  const internal::MagicTables& tables = internal::kMagicTables;
+  return tables.rook_attacks[tables.rook_magics[square].Index(occupied)];
+}
+
+inline Bitboard BishopAttacks(int8_t square, Bitboard occupied) {
+  const internal::MagicTables& tables = internal::kMagicTables;
+  return tables.bishop_attacks[tables.bishop_magics[square].Index(occupied)];
+}
+
+inline Bitboard QueenAttacks(int8_t square, Bitboard occupied) {
+  return RookAttacks(square, occupied) | BishopAttacks(square, occupied);
+}
+
+// Empty if squares don't share a line.
+constexpr Bitboard Between(int8_t first, int8_t second) {
+  return internal::kGeometryTables.between[first][second];
+}
+
+// Empty if squares don't share a line.
+constexpr Bitboard Line(int8_t first, int8_t second) {
+  return internal::kGeometryTables.line[first][second];
+}
+
+// The number of king moves between two squares.
+constexpr int8_t Distance(int8_t first, int8_t second) {
+  return internal::kGeometryTables.distance[first][second];
+}
+
+// How many steps in the direction 'delta' fit on the board. Both
+// components of 'delta' are -1, 0 or 1.
+constexpr int8_t SquaresToEdge(int8_t square, Coordinates delta) {
+  const internal::GeometryTables& tables = internal::kGeometryTables;
+  return tables.squares_to_edge[square][delta.file + 1][delta.rank + 1];
+}
+
+// Change of the square index after one step in the direction 'delta'.
+constexpr int8_t DirectionOffset(Coordinates delta) {
+  return delta.rank*8 + delta.file;
+}
+
+}  // namespace chess_engine
+
+#endif  // SRC_BITBOARD_H_
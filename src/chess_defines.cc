@@ -5,16 +5,6 @@
 
 namespace chess_engine {
 
-Player Opponent(Player player) {
-  if (player == Player::kWhite) {
-    return Player::kBlack;
-  } else if (player == Player::kBlack) {
-    return Player::kWhite;
-  }
-  assert(false);  // Invalid player.
-  return Player::kNone;
-}
-
 Coordinates& Coordinates::operator+=(Coordinates other) {
   file += other.file;
   rank += other.rank;
@@ -89,43 +79,18 @@ bool BelongsToSegment(Segment segment, Coordinates point) {
   return true;
 }
 
-bool operator==(Move first, Move second) {
-  return first.from == second.from &&
-    first.to == second.to && first.piece == second.piece;
-}
-
-bool operator!=(Move first, Move second) {
-  return !(first == second);
-}
-
-int8_t DoubleJumpRank(Player player) {
-  if (player == Player::kWhite) {
-    return 1;
-  } else if (player == Player::kBlack) {
-    return 6;
-  }
-  assert(false);  // Invalid player value.
-  return -1;
-}
-
-int8_t PromotionRank(Player player) {
-  if (player == Player::kWhite) {
-    return 7;
-  } else if (player == Player::kBlack) {
-    return 0;
-  }
-  assert(false);  // Invalid player value.
-  return -1;
-}
-
-int8_t PawnDirection(Player player) {
-  if (player == Player::kWhite) {
-    return 1;
-  } else if (player == Player::kBlack) {
-    return -1;
+Move::Move(Coordinates from, Coordinates to, Piece promote_to) {
+  PieceType promotion = PieceType::kNone;
+  for (PieceType option : kPromotionOptions) {
+    if (promote_to.type == option) {
+      promotion = option;
+    }
   }
-  assert(false);  // Invalid player value.
-  return 0;
+  *this = Move(
+    static_cast<int8_t>(from.rank*8 + from.file),
+    static_cast<int8_t>(to.rank*8 + to.file),
+    promotion
+  );
 }
 
 bool WithinTheBoard(Coordinates square) {
@@ -5,6 +5,7 @@
 // All code that works with the engine needs most of it.
 
 #include <array>
+#include <cassert>
 #include <cstdint>
 
 namespace chess_engine {
@@ -25,7 +26,16 @@ enum struct Player {
   kBlack = 2
 };
 
-Player Opponent(Player player);
+constexpr Player Opponent(Player player) {
+  if (player == Player::kWhite) {
+    return Player::kBlack;
+  } else if (player == Player::kBlack) {
+    return Player::kWhite;
+  }
+  assert(false);  // Invalid player.
+  return Player::kNone;
+}
+
 struct Piece {
   PieceType type;
   Player player;
@@ -88,20 +98,93 @@ struct Segment {
 bool BelongsToLine(Segment line, Coordinates point);
 bool BelongsToSegment(Segment segment, Coordinates point);
 
-struct Move {
-  Coordinates from;
-  Coordinates to;
-  Piece piece;  // Piece that moves or piece to promote to.
+// Packed into 16 bits, so moves are cheap to store in lists and tables.
+// Bits 0-5 hold the origin square, bits 6-11 hold the destination
+// (both as rank*8 + file), bits 12-14 hold the type of the piece
+// to promote to. All zeros stand for the null move.
+class Move {
+ public:
+  constexpr Move() = default;
+  // Only the type of the 'promote_to' piece is kept, and only if it's
+  // one of kPromotionOptions.
+  Move(Coordinates from, Coordinates to, Piece promote_to = pieces::kNone);
+  Move(int8_t from, int8_t to, PieceType promote_to = PieceType::kNone):
+    data_(from | to << 6 | static_cast<int>(promote_to) << 12)
+  {}
+
+  int8_t GetFromIndex() const {
+    return data_ & 0x3F;
+  }
+  int8_t GetToIndex() const {
+    return (data_ >> 6) & 0x3F;
+  }
+  Coordinates GetFrom() const {
+    return {
+      static_cast<int8_t>(data_ & 7), static_cast<int8_t>((data_ >> 3) & 7)
+    };
+  }
+  Coordinates GetTo() const {
+    return {
+      static_cast<int8_t>((data_ >> 6) & 7),
+      static_cast<int8_t>((data_ >> 9) & 7)
+    };
+  }
+  PieceType GetPromotion() const {
+    return static_cast<PieceType>(data_ >> 12);
+  }
+
+  // Raw bits, for storing moves in tables.
+  uint16_t GetData() const {
+    return data_;
+  }
+  static Move FromData(uint16_t data) {
+    Move ret;
+    ret.data_ = data;
+    return ret;
+  }
+
+  bool operator==(Move other) const {
+    return data_ == other.data_;
+  }
+  bool operator!=(Move other) const {
+    return data_ != other.data_;
+  }
+
+ private:
+  uint16_t data_ = 0;
 };
 
-const Move kNullMove = {{-1, -1}, {-1, -1}, pieces::kNone};
-
-bool operator==(Move first, Move second);
-bool operator!=(Move first, Move second);
-
-int8_t DoubleJumpRank(Player player);
-int8_t PromotionRank(Player player);
-int8_t PawnDirection(Player player);
+const Move kNullMove = Move();
+
+constexpr int8_t DoubleJumpRank(Player player) {
+  if (player == Player::kWhite) {
+    return 1;
+  } else if (player == Player::kBlack) {
+    return 6;
+  }
+  assert(false);  // Invalid player value.
+  return -1;
+}
+
+constexpr int8_t PromotionRank(Player player) {
+  if (player == Player::kWhite) {
+    return 7;
+  } else if (player == Player::kBlack) {
+    return 0;
+  }
+  assert(false);  // Invalid player value.
+  return -1;
+}
+
+constexpr int8_t PawnDirection(Player player) {
+  if (player == Player::kWhite) {
+    return 1;
+  } else if (player == Player::kBlack) {
+    return -1;
+  }
+  assert(false);  // Invalid player value.
+  return 0;
+}
 
 bool WithinTheBoard(Coordinates square);
 
@@ -1,7 +1,6 @@
 #include "src/count_moves.h"
 
-#include <vector>
-
+#include "src/move_list.h"
 #include "src/node.h"
 #include "src/position.h"
 #include "src/position_table.h"
@@ -10,47 +9,54 @@
 namespace chess_engine {
 
 int64_t CountMoves(const Position& position, int depth) {
+  Position copy = position;
+  return CountMoves(&copy, depth);
+}
+
+int64_t CountMoves(Position* position, int depth) {
   if (!depth) {
     return 1;
   }
   int64_t ret = 0;
-  std::vector<Move> legal_moves = position.GetLegalMoves();
+  MoveList legal_moves;
+  position->GetLegalMoves(&legal_moves);
   if (depth == 1) {
-    return legal_moves.size();
+    return legal_moves.Size();
   }
-  for (Move move : legal_moves) {
-    Position new_position = position;
-    new_position.MakeMove(move);
-    ret += CountMoves(new_position, depth-1);
+  Position::UndoInfo undo;
+  for (const MoveList::Entry& entry : legal_moves) {
+    position->MakeMove(entry.move, &undo);
+    ret += CountMoves(position, depth-1);
+    position->UnmakeMove(undo);
   }
   return ret;
 }
 
 int64_t CountMovesWithHash(
-  const Node& node, int depth, PositionTable<HashEntry, 24> *table
+  Node* node, int depth, PositionTable<HashEntry, 24> *table
 ) {
   if (!depth) {
     return 1;
   }
   int64_t ret = 0;
-  std::vector<Move> legal_moves = node.GetLegalMoves();
+  MoveList legal_moves;
+  node->GetLegalMoves(&legal_moves);
   if (depth == 1) {
-    table->Set(
-      node.GetHash(), {depth, static_cast<int64_t>(legal_moves.size())}
-    );
-    return legal_moves.size();
+    table->Set(node->GetHash(), {depth, legal_moves.Size()});
+    return legal_moves.Size();
   }
-  for (Move move : legal_moves) {
-    Node new_node = node;
-    HashEntry hashed = table->Get(node.HashAfterMove(move).Get());
+  for (const MoveList::Entry& entry : legal_moves) {
+    Move move = entry.move;
+    HashEntry hashed = table->Get(node->GetHashAfterMove(move));
     if (hashed.depth == depth-1) {
       ret += hashed.count;
     } else {
-      new_node.MakeMove(move);
-      ret += CountMovesWithHash(new_node, depth-1, table);
+      node->MakeMove(move);
+      ret += CountMovesWithHash(node, depth-1, table);
+      node->UnmakeMove();
     }
   }
-  table->Set(node.GetHash(), {depth, ret});
+  table->Set(node->GetHash(), {depth, ret});
   return ret;
 }
 
@@ -59,7 +65,7 @@ int64_t CountMovesWithHash(
 ) {
   Node root(position, func);
   PositionTable<HashEntry, 24> table;
-  int64_t ret = CountMovesWithHash(root, depth, &table);
+  int64_t ret = CountMovesWithHash(&root, depth, &table);
   return ret;
 }
 
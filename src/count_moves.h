@@ -9,17 +9,22 @@
 namespace chess_engine {
 
 int64_t CountMoves(const Position& position, int depth);
+// Makes and unmakes moves in place, leaving the position unchanged.
+int64_t CountMoves(Position* position, int depth);
 
 struct HashEntry {
   int depth = -1;
   int64_t count = -1;
 };
 
+// Makes and unmakes moves in place, leaving the node unchanged.
 int64_t CountMovesWithHash(
-  const Node& node, int depth, PositionTable<HashEntry, 24> *table
+  Node* node, int depth, PositionTable<HashEntry, 24> *table
 );
 int64_t CountMovesWithHash(
-  const Position& pos, int depth, const ZobristHashFunction& func
+  const Position& pos,
+  int depth,
+  const ZobristHashFunction& func = kZobristHash
 );
 
 
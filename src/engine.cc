@@ -2,14 +2,24 @@
 
 #include <algorithm>
 #include <cassert>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "src/bitboard.h"
+#include "src/move_list.h"
+#include "src/move_picker.h"
+
 namespace chess_engine {
 
-Engine::Engine(const Position& position, const ZobristHashFunction hash_func):
+Engine::Engine(
+  const Position& position,
+  const ZobristHashFunction& hash_func
+):
   root_(position, hash_func)
-{}
+{
+  SetThreadCount(1);
+}
 
 int32_t Engine::GetEvaluation(int16_t min_depth) {
   if (root_info_.depth < min_depth) {
@@ -28,18 +38,34 @@ Move Engine::GetBestMove(int16_t min_depth) {
 void Engine::StartSearch() {
   NodeInfo last;
   proceed_with_batch_value_ = true;
-  nodes_visited_ = 0;
+  ResetThreads();
+  transposition_table_.NewSearch();
+  for (const std::unique_ptr<SearchThread>& thread : threads_) {
+    thread->nodes_visited = 0;
+  }
+  // Half of the helpers start a ply deeper, so threads don't all search
+  // the same tree at the same time.
+  for (size_t i = 1; i < threads_.size(); ++i) {
+    helpers_.emplace_back(
+      &Engine::RunHelperSearch, this, threads_[i].get(), 1 + i % 2
+    );
+  }
+  SearchThread* main_thread = threads_[0].get();
   for (int16_t i = 1; i < max_depth_; ++i) {
-    last = RunSearch(i, 0);
+    last = RunSearch(main_thread, i, 0);
     if (last.depth != -1) {
       root_info_ = last;
       report_progress_(
-        i, root_info_.eval, nodes_visited_, principal_variation_
+        i,
+        root_info_.eval,
+        GetNodesVisited(),
+        main_thread->principal_variation
       );
     } else {
       break;
     }
   }
+  StopHelpers();
 }
 
 void Engine::SetBatchSize(int64_t value) {
@@ -59,14 +85,17 @@ void Engine::SetReportProgressCallback(
 }
 
 void Engine::MakeMove(Move move) {
+  StopHelpers();
   no_return_table_.Set(root_.GetHash(), true);
-  root_.MakeMove(move);
+  root_.MakeIrreversibleMove(move);
   root_info_ = NodeInfo();
 }
 
 void Engine::SetPosition(const Position& position) {
+  StopHelpers();
   root_.SetPosition(position);
-  transposition_table_.Clear();
+  // Entries are still correct for their positions, they only age
+  // with the next search.
   no_return_table_.Clear();
 }
 
@@ -74,6 +103,10 @@ const Position& Engine::GetPosition() const {
   return root_.GetPosition();
 }
 
+const Node& Engine::GetRoot() const {
+  return root_;
+}
+
 int32_t Engine::SimpleEvaluate(const Node& node) {
   // TODO(Andrey): Better evaluation function.
   int32_t ret = 0;
@@ -81,42 +114,44 @@ int32_t Engine::SimpleEvaluate(const Node& node) {
   Player opponent = Opponent(to_move);
   Coordinates king = node.GetKing(to_move);
   Coordinates opponents_king = node.GetKing(Opponent(to_move));
+  const Position& position = node.GetPosition();
+
+  // Material.
+  for (int type = 1; type <= 6; ++type) {
+    PieceType piece_type = static_cast<PieceType>(type);
+    ret += piece_values[type-1]*(
+      CountSquares(position.GetPieces(piece_type, to_move)) -
+      CountSquares(position.GetPieces(piece_type, opponent))
+    );
+  }
+
+  // Board control.
+  ret += position.GetTotalAttacks(to_move);
+  ret -= position.GetTotalAttacks(opponent);
+
+  // King safety, only the squares around the kings are visited.
   int32_t king_freedom = 0;
   int32_t king_denominator = 0;
+  Bitboard around_king =
+    KingAttacks(SquareIndex(king)) | SquareBitboard(king);
+  while (around_king) {
+    Coordinates square = IndexToCoordinates(PopLowestSquare(&around_king));
+    if (!node.GetAttacksByPlayer(square, opponent)) {
+      king_freedom += 100;
+    }
+    ++king_denominator;
+  }
   int32_t opponents_king_freedom = 0;
   int32_t opponents_king_denominator = 0;
-  for (int8_t file = 0; file < 8; ++file) {
-    for (int8_t rank = 0; rank < 8; ++rank) {
-      // King safety.
-      int8_t king_distance = DistanceSquared(king, {file, rank});
-      if (king_distance <= 2) {
-        if (!node.GetAttacksByPlayer({file, rank}, opponent)) {
-          king_freedom += 100;
-        }
-        ++king_denominator;
-      }
-      int8_t opponents_king_distance =
-        DistanceSquared(opponents_king, {file, rank});
-
-      if (opponents_king_distance <= 2) {
-        if (!node.GetAttacksByPlayer({file, rank}, to_move)) {
-          opponents_king_freedom += 100;
-        }
-        ++opponents_king_denominator;
-      }
-
-      // Board control.
-      ret += node.GetAttacksByPlayer({file, rank}, to_move);
-      ret -= node.GetAttacksByPlayer({file, rank}, opponent);
-
-      // Material.
-      Piece piece = node.GetSquare({file, rank});
-      if (piece != pieces::kNone) {
-        ret += piece.player == to_move?
-          piece_values[static_cast<int>(piece.type)-1]:
-          -piece_values[static_cast<int>(piece.type)-1];
-      }
+  Bitboard around_opponents_king =
+    KingAttacks(SquareIndex(opponents_king)) | SquareBitboard(opponents_king);
+  while (around_opponents_king) {
+    Coordinates square =
+      IndexToCoordinates(PopLowestSquare(&around_opponents_king));
+    if (!node.GetAttacksByPlayer(square, to_move)) {
+      opponents_king_freedom += 100;
     }
+    ++opponents_king_denominator;
   }
   king_freedom /= king_denominator;
   ret += king_freedom;
@@ -126,17 +161,45 @@ int32_t Engine::SimpleEvaluate(const Node& node) {
 }
 
 std::list<Move> Engine::GetPrincipalVariation() const {
-  return principal_variation_;
+  return threads_[0]->principal_variation;
 }
 
 int64_t Engine::GetNodesVisited() const {
-  return nodes_visited_;
+  int64_t ret = 0;
+  for (const std::unique_ptr<SearchThread>& thread : threads_) {
+    ret += thread->nodes_visited.load(std::memory_order_relaxed);
+  }
+  return ret;
 }
 
 void Engine::UseTranspositionTable(bool value) {
   use_transposition_table_ = value;
 }
 
+bool Engine::SetHashSize(size_t megabytes) {
+  StopHelpers();
+  return transposition_table_.Resize(megabytes);
+}
+
+void Engine::ClearHash() {
+  StopHelpers();
+  int thread_count = std::max(1u, std::thread::hardware_concurrency());
+  transposition_table_.Clear(thread_count);
+}
+
+void Engine::SetThreadCount(int count) {
+  assert(count >= 1);  // There is always the main thread.
+  StopHelpers();
+  // Keeps the existing threads, so the main one keeps its variation.
+  while (static_cast<int>(threads_.size()) > count) {
+    threads_.pop_back();
+  }
+  while (static_cast<int>(threads_.size()) < count) {
+    threads_.push_back(std::make_unique<SearchThread>());
+  }
+  threads_[0]->is_main = true;
+}
+
 int32_t Engine::GetLowestEval() {
   return lowest_eval_;
 }
@@ -147,163 +210,137 @@ int32_t Engine::GetLongestCheckmate() {
   return longest_checkmate_;
 }
 
-void Engine::SortMoves(
-  std::vector<Move>* moves, const Node& node, int16_t ply
-) {
-  // TODO(Andrey): Might be faster to use std::sort at this point.
-  int insert_index = 0;
-
-  // Old best move.
-  NodeInfo old_info = transposition_table_.Get(node.GetHash());
-  for (
-    int read_index = insert_index;
-    read_index < static_cast<int>(moves->size());
-    ++read_index
-  ) {
-    if ((*moves)[read_index] == old_info.best_move) {
-      std::swap((*moves)[insert_index], (*moves)[read_index]);
-      ++insert_index;
-    }
-  }
-
-  // PV Move.
-  if (static_cast<int>(principal_variation_.size()) > ply) {
-    auto pv_iterator = principal_variation_.begin();
-    std::advance(pv_iterator, ply);
-    Move pv_move = *pv_iterator;
-    for (
-      int read_index = insert_index;
-      read_index < static_cast<int>(moves->size());
-      ++read_index
-    ) {
-      if ((*moves)[read_index] == pv_move) {
-        std::swap((*moves)[insert_index], (*moves)[read_index]);
-        ++insert_index;
-      }
-    }
+void Engine::VisitNode(SearchThread* thread) {
+  // Only this thread writes the counter, so there is no need for
+  // an atomic read-modify-write. Relaxed loads and stores are enough
+  // for the main thread to read it while the search runs.
+  thread->nodes_visited.store(
+    thread->nodes_visited.load(std::memory_order_relaxed) + 1,
+    std::memory_order_relaxed
+  );
+  if (!thread->is_main) {
+    return;
   }
-
-  // Cut moves.
-  for (
-    int read_index = insert_index;
-    read_index < static_cast<int>(moves->size());
-    ++read_index
-  ) {
-    if (
-      (*moves)[read_index] == cut_moves[ply].first ||
-      (*moves)[read_index] == cut_moves[ply].second
-    ) {
-      std::swap((*moves)[insert_index], (*moves)[read_index]);
-      ++insert_index;
-    }
+  ++processed_in_the_batch_;
+  if (processed_in_the_batch_ >= batch_size_) {
+    proceed_with_batch_value_ = proceed_with_batch_();
+    processed_in_the_batch_ = 0;
   }
+}
 
-  // Some of the checks.
-  for (
-    int read_index = insert_index;
-    read_index < static_cast<int>(moves->size());
-    ++read_index
-  ) {
-    if (node.MoveIsCheckFast((*moves)[read_index])) {
-      std::swap((*moves)[insert_index], (*moves)[read_index]);
-      ++insert_index;
-    }
+Move Engine::GetPVMove(const SearchThread& thread, int16_t ply) const {
+  if (static_cast<int>(thread.principal_variation.size()) <= ply) {
+    return kNullMove;
   }
+  auto pv_iterator = thread.principal_variation.begin();
+  std::advance(pv_iterator, ply);
+  return *pv_iterator;
+}
 
-  // Captures.
-  for (
-    int read_index = insert_index;
-    read_index < static_cast<int>((*moves).size());
-    ++read_index
-  ) {
-    if (node.GetSquare((*moves)[read_index].to) != pieces::kNone) {
-      std::swap((*moves)[insert_index], (*moves)[read_index]);
-      ++insert_index;
-    }
+NodeInfo Engine::EvaluateTerminal(const Node& node, int16_t depth) {
+  // Checkmate or stalemate.
+  int32_t eval = node.IsCheck() ? lowest_eval_ : 0;
+  NodeInfo ret = {depth, NodeType::kPV, eval, kNullMove};
+  if (use_transposition_table_) {
+    transposition_table_.Set(node.GetHash(), ret);
   }
+  return ret;
 }
 
-Engine::NodeInfo Engine::RunSearch(
+NodeInfo Engine::RunSearch(
   int16_t depth,
   int16_t check_extra_depth,
-  const Node& node,
+  SearchThread* thread,
   std::list<Move>* parent_variation,
   int32_t alpha,
   int32_t beta,
   int16_t ply
 ) {
-  ++processed_in_the_batch_;
-  if (processed_in_the_batch_ >= batch_size_) {
-    proceed_with_batch_value_ = proceed_with_batch_();
-    processed_in_the_batch_ = 0;
-  }
-  if (!proceed_with_batch_) {
+  VisitNode(thread);
+  if (!proceed_with_batch_value_) {
     return NodeInfo();
   }
-  ++nodes_visited_;
+  Node* node = &thread->node;
   NodeInfo ret;
-  if (node.IsCheckmate()) {
-    ret = {depth, NodeType::kPV, lowest_eval_, kNullMove};
-  }
-  if (node.IsStalemate()) {
-    ret = {depth, NodeType::kPV, 0, kNullMove};
-  }
-  if (ret.depth >= 0) {
+  // A draw, no matter how deep the search goes.
+  if (ply && node->IsInsufficientMaterial()) {
+    ret = {max_depth_, NodeType::kPV, 0, kNullMove};
     if (use_transposition_table_) {
-      transposition_table_.Set(node.GetHash(), ret);
+      transposition_table_.Set(node->GetHash(), ret);
     }
     return ret;
   }
-
-  std::vector<Move> legal_moves;
-  if (depth > 0) {
-    legal_moves = node.GetLegalMoves();
-    SortMoves(&legal_moves, node, ply);
-  } else {
-    if (node.GetLastCapture() != Coordinates{-1, -1}) {
-      legal_moves = node.GetCapturesOnSquare(
-        node.GetLastCapture(), node.PlayerToMove()
-      );
-      legal_moves.push_back(kNullMove);  // Hack for now.
-    } else {
-      return {0, NodeType::kPV, SimpleEvaluate(node), kNullMove};
+  if (depth <= 0) {
+    int32_t eval = Quiesce(thread, alpha, beta);
+    if (!proceed_with_batch_value_) {
+      return NodeInfo();
+    }
+    ret = {0, NodeType::kPV, eval, kNullMove};
+    if (eval <= alpha) {
+      ret.type = NodeType::kFailLow;
+    } else if (eval >= beta) {
+      ret.type = NodeType::kFailHigh;
+    }
+    if (use_transposition_table_) {
+      transposition_table_.Set(node->GetHash(), ret);
     }
+    return ret;
   }
 
-  Move best_move = legal_moves[0];
+  // Moves are generated lazily, most cut nodes never generate quiet moves.
+  MovePicker picker(
+    node->GetPosition(),
+    transposition_table_.Get(node->GetHash()).best_move,
+    GetPVMove(*thread, ply),
+    thread->cut_moves[ply]
+  );
+
+  bool first_move = true;
+  Move best_move = kNullMove;
   int32_t eval = lowest_eval_;
   NodeType type = NodeType::kFailLow;
   std::list<Move> principal_variation;  // Best line from a subcall.
 
-  for (Move move : legal_moves) {
+  Move move;
+  while (picker.GetNextMove(&move)) {
+    // Principal variation search: only the first move gets the full
+    // window. The rest are expected to be worse, which is cheaper to
+    // prove with a null window. If a move turns out to be better, the
+    // bounds below are wrong, and the move is searched again.
+    int32_t child_beta = alpha + 1;
+    if (first_move) {
+      best_move = move;
+      first_move = false;
+      child_beta = beta;
+    }
+    // The bucket is fetched while the extensions are worked out.
+    uint64_t new_hash = node->GetHashAfterMove(move);
+    transposition_table_.Prefetch(new_hash);
     int16_t child_depth = depth;
-    if (child_depth <= 0) {
-      child_depth = 1;  // We are already doing a quiescense search.
-    } else {
-      if (check_extra_depth && (node.IsCheck() || node.MoveIsCheckFast(move))) {
-        ++child_depth;
-        --check_extra_depth;
-      }
+    if (
+      check_extra_depth &&
+      (node->IsCheck() || node->GivesCheck(move))
+    ) {
+      ++child_depth;
+      --check_extra_depth;
     }
-    
-    // Search tables.
-    ZobristHash new_hash = node.HashAfterMove(move);
+
+    // Search tables. The move is only made, if the child is searched.
+    bool move_made = false;
     NodeInfo child;
-    if (no_return_table_.Get(new_hash.Get())) {
-      child = {
-        max_depth_, NodeType::kPV, 0, {{-1, -1}, {-1, -1}, pieces::kNone}
-      };
+    if (no_return_table_.Get(new_hash)) {
+      child = {max_depth_, NodeType::kPV, 0, kNullMove};
     } else {
-      child = transposition_table_.Get(new_hash.Get());
+      child = transposition_table_.Get(new_hash);
       if (child.depth < child_depth-1) {
-        Node new_node = node;
-        new_node.MakeMove(move);
+        node->MakeMove(move);
+        move_made = true;
         child = RunSearch(
           child_depth-1,
           check_extra_depth,
-          new_node,
+          thread,
           &principal_variation,
-          -beta, -alpha, ply+1
+          -child_beta, -alpha, ply+1
         );
       }
     }
@@ -312,33 +349,40 @@ Engine::NodeInfo Engine::RunSearch(
     switch (child.type) {
     case NodeType::kFailLow:
       if (-child.eval < beta) {
-        Node new_node = node;
-        new_node.MakeMove(move);
+        if (!move_made) {
+          node->MakeMove(move);
+          move_made = true;
+        }
         int32_t new_alpha = std::max(alpha, -child.eval);
         child = RunSearch(
           child_depth-1,
           check_extra_depth,
-          new_node,
+          thread,
           &principal_variation,
           -beta, -new_alpha, ply+1
         );
       }
       break;
     case NodeType::kFailHigh:
-        if (alpha < -child.eval) {
-        Node new_node = node;
-        new_node.MakeMove(move);
+      if (alpha < -child.eval) {
+        if (!move_made) {
+          node->MakeMove(move);
+          move_made = true;
+        }
         int32_t new_beta = std::min(beta, -child.eval);
         child = RunSearch(
           child_depth-1,
           check_extra_depth,
-          new_node,
+          thread,
           &principal_variation,
           -new_beta, -alpha, ply+1
         );
       }
       break;
     }
+    if (move_made) {
+      node->UnmakeMove();
+    }
 
     // Could've changed after subcalls.
     if (!proceed_with_batch_value_) {
@@ -355,60 +399,159 @@ Engine::NodeInfo Engine::RunSearch(
       alpha = -child.eval;
       *parent_variation = principal_variation;
       parent_variation->push_front(move);
-      if (ply == 0) {
+      if (ply == 0 && thread->is_main) {
         int32_t eval_to_report = eval;
         if (eval_to_report > highest_eval_ - longest_checkmate_) {
           --eval_to_report;
         }
         report_progress_(
-          depth, eval_to_report, nodes_visited_, principal_variation_
+          depth, eval_to_report, GetNodesVisited(), *parent_variation
         );
       }
     }
     if (alpha >= beta) {
       // Node is a cut node.
       type = NodeType::kFailHigh;
-      if (!node.MoveIsCheckFast(move) &&
-        node.GetSquare(move.to) == pieces::kNone &&
-        cut_moves[ply].first != move
+      std::pair<Move, Move>& cut_moves = thread->cut_moves[ply];
+      if (!node->GivesCheck(move) &&
+        node->GetSquare(move.GetTo()) == pieces::kNone &&
+        cut_moves.first != move
       ) {
-        cut_moves[ply].second = cut_moves[ply].first;
-        cut_moves[ply].first = move;
+        cut_moves.second = cut_moves.first;
+        cut_moves.first = move;
       }
       break;
     }
   }
 
+  if (first_move) {
+    return EvaluateTerminal(*node, depth);
+  }
+
   // Write to transposition table and return.
   if (eval > highest_eval_ - longest_checkmate_) {
     --eval;
   }
   ret = {depth, type, eval, best_move};
   if (use_transposition_table_) {
-    transposition_table_.Set(node.GetHash(), ret);
+    transposition_table_.Set(node->GetHash(), ret);
   }
   return ret;
 }
 
-Engine::NodeInfo Engine::RunSearch(int16_t depth, int16_t check_extra_depth) {
-  return RunSearch(depth, check_extra_depth, root_, &principal_variation_);
+int32_t Engine::Quiesce(
+  SearchThread* thread, int32_t alpha, int32_t beta
+) {
+  VisitNode(thread);
+  if (!proceed_with_batch_value_) {
+    return 0;
+  }
+  Node* node = &thread->node;
+
+  // The side to move can usually do at least as good as the static
+  // evaluation by not capturing anything (aka "standing pat"),
+  // unless it's in check and has to deal with it.
+  bool in_check = node->IsCheck();
+  int32_t eval = lowest_eval_;
+  if (!in_check) {
+    eval = SimpleEvaluate(*node);
+    if (eval >= beta) {
+      return eval;
+    }
+    alpha = std::max(alpha, eval);
+  }
+
+  MovePicker picker = in_check ?
+    MovePicker(node->GetPosition(), kNullMove, kNullMove, {}) :
+    MovePicker(node->GetPosition());
+  Move move;
+  while (picker.GetNextMove(&move)) {
+    if (!in_check && move.GetPromotion() == PieceType::kNone) {
+      // Delta pruning: skip captures, that can't bring the evaluation
+      // anywhere near alpha, even with a margin for positional gains.
+      Piece victim = node->GetSquare(move.GetTo());
+      int32_t gain = victim == pieces::kNone ?
+        piece_values[static_cast<int>(PieceType::kPawn)-1] :
+        piece_values[static_cast<int>(victim.type)-1];
+      if (eval + gain + delta_margin_ <= alpha) {
+        continue;
+      }
+    }
+    node->MakeMove(move);
+    int32_t child_eval = -Quiesce(thread, -beta, -alpha);
+    node->UnmakeMove();
+    if (!proceed_with_batch_value_) {
+      return 0;
+    }
+    if (child_eval > eval) {
+      eval = child_eval;
+    }
+    if (eval > alpha) {
+      alpha = eval;
+    }
+    if (alpha >= beta) {
+      break;
+    }
+  }
+  // Closer mates are better.
+  if (eval > highest_eval_ - longest_checkmate_) {
+    --eval;
+  }
+  return eval;
+}
+
+NodeInfo Engine::RunSearch(
+  SearchThread* thread, int16_t depth, int16_t check_extra_depth
+) {
+  return RunSearch(
+    depth, check_extra_depth, thread, &thread->principal_variation
+  );
 }
 
-Engine::NodeInfo Engine::RunIncrementalSearch(int16_t depth) {
+NodeInfo Engine::RunIncrementalSearch(int16_t depth) {
+  ResetThreads();
+  transposition_table_.NewSearch();
   for (int i = 1; i < depth; ++i) {
-    RunSearch(i);
+    RunSearch(threads_[0].get(), i);
   }
-  return RunSearch(depth);
+  return RunSearch(threads_[0].get(), depth);
 }
 
-Engine::NodeInfo Engine::RunInfiniteSearch(
+NodeInfo Engine::RunInfiniteSearch(
   std::function<bool(int16_t)> proceed
 ) {
+  ResetThreads();
+  transposition_table_.NewSearch();
   NodeInfo ret;
   for (int i = 1; proceed(i); ++i) {
-    ret = RunSearch(i);
+    ret = RunSearch(threads_[0].get(), i);
   }
   return ret;
 }
 
+void Engine::RunHelperSearch(SearchThread* thread, int16_t first_depth) {
+  for (int16_t i = first_depth; i < max_depth_; ++i) {
+    if (RunSearch(thread, i).depth == -1) {
+      break;
+    }
+  }
+}
+
+void Engine::StopHelpers() {
+  if (helpers_.empty()) {
+    return;
+  }
+  proceed_with_batch_value_ = false;
+  for (std::thread& helper : helpers_) {
+    helper.join();
+  }
+  helpers_.clear();
+}
+
+void Engine::ResetThreads() {
+  for (const std::unique_ptr<SearchThread>& thread : threads_) {
+    thread->node = root_;
+  }
+}
+
 }  // namespace chess_engine
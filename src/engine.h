@@ -2,27 +2,39 @@
 #define SRC_ENGINE_H_
 
 #include <array>
+#include <atomic>
+#include <cstddef>
 #include <functional>
 #include <limits>
 #include <list>
+#include <memory>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "src/chess_defines.h"
 #include "src/node.h"
 #include "src/position_table.h"
+#include "src/transposition_table.h"
 #include "src/zobrist_hash.h"
 
 namespace chess_engine {
 
 class Engine {
  public:
-  Engine(const Position& position, const ZobristHashFunction hash_func);
+  // The hash function must outlive the engine.
+  explicit Engine(
+    const Position& position,
+    const ZobristHashFunction& hash_func = kZobristHash
+  );
 
   int32_t GetEvaluation(int16_t min_depth = 0);
   Move GetBestMove(int16_t min_depth = 0);
 
-  // Run batch search.
+  // Run batch search. Helper threads, if there are any, search the same
+  // position, sharing the transposition table with the main thread.
+  // The callbacks are only called from the main thread, and may change
+  // the engine, helpers are stopped first.
   void StartSearch();
 
   void SetBatchSize(int64_t size);
@@ -42,43 +54,77 @@ class Engine {
 
   void SetPosition(const Position& position);
   const Position& GetPosition() const;
+  // Node, the search starts from.
+  const Node& GetRoot() const;
 
   std::list<Move> GetPrincipalVariation() const;
   int64_t GetNodesVisited() const;
 
   void UseTranspositionTable(bool value);
+  // Reallocates the transposition table, forgetting everything in it.
+  // Returns false and keeps the old table, if there is not enough memory.
+  bool SetHashSize(size_t megabytes);
+  // Forgets everything in the transposition table, when the results
+  // of the previous game are no longer useful.
+  void ClearHash();
+  // Number of threads StartSearch uses, including the main one.
+  // Searches with a fixed depth only use the main thread.
+  void SetThreadCount(int count);
 
   static int32_t GetHighestEval();
   static int32_t GetLowestEval();
   static int32_t GetLongestCheckmate();
 
  private:
-  enum struct NodeType {
-    kFailLow = 0,
-    kPV = 1,
-    kFailHigh = 2
-  };
-  struct NodeInfo {
-    int16_t depth = -1;
-    NodeType type;
-    int32_t eval = 0;
-    Move best_move = kNullMove;
+  // State of one searching thread. Threads share the transposition
+  // table, but order moves by their own cut moves and variation.
+  struct alignas(64) SearchThread {
+    Node node;
+    std::list<Move> principal_variation;
+    std::vector<std::pair<Move, Move>> cut_moves =
+      std::vector<std::pair<Move, Move>>(max_depth_, {kNullMove, kNullMove});
+    // Only written by the thread itself, but read by the main one.
+    std::atomic<int64_t> nodes_visited = 0;
+    bool is_main = false;
   };
+
+  // Makes and unmakes moves on the thread's node in place,
+  // the node is unchanged when the function returns.
   NodeInfo RunSearch(
     int16_t depth,
     int16_t check_extra_depth,
-    const Node& node,
+    SearchThread* thread,
     std::list<Move>* parent_variation,
     int32_t alpha = lowest_eval_,
     int32_t beta = highest_eval_,
     int16_t ply = 0
   );
 
-  NodeInfo RunSearch(int16_t depth, int16_t check_extra_depth = 0);
+  NodeInfo RunSearch(
+    SearchThread* thread, int16_t depth, int16_t check_extra_depth = 0
+  );
   NodeInfo RunIncrementalSearch(int16_t depth);
   NodeInfo RunInfiniteSearch(std::function<bool(int16_t)> proceed);
-
-  void SortMoves(std::vector<Move>* moves, const Node& node, int16_t ply);
+  // Iterative deepening of a helper thread, until the search stops.
+  void RunHelperSearch(SearchThread* thread, int16_t first_depth);
+  // Threads start searching from the current root.
+  void ResetThreads();
+  // Stops the search and waits for the helper threads to finish.
+  // Called before the engine changes, as helpers read it.
+  void StopHelpers();
+
+  // Counts the node. The main thread also calls back,
+  // when the batch is processed.
+  void VisitNode(SearchThread* thread);
+
+  // Quiescence search: only captures and promotions are searched,
+  // unless the player to move is in check.
+  int32_t Quiesce(SearchThread* thread, int32_t alpha, int32_t beta);
+
+  // Move from the previous principal variation, if it goes this deep.
+  Move GetPVMove(const SearchThread& thread, int16_t ply) const;
+  // For positions without legal moves.
+  NodeInfo EvaluateTerminal(const Node& node, int16_t depth);
 
   Node root_;
   NodeInfo root_info_;
@@ -86,28 +132,32 @@ class Engine {
   std::array<int32_t, 6> piece_values = {1000, 5000, 3000, 3000, 9000, 0};
 
   std::list<Move> current_variation_;
-  std::list<Move> principal_variation_;
-  int64_t nodes_visited_;
+  // The first thread is the main one, it reports the progress and
+  // decides when to stop.
+  std::vector<std::unique_ptr<SearchThread>> threads_;
+  std::vector<std::thread> helpers_;
 
-  PositionTable<NodeInfo, 25> transposition_table_;
+  TranspositionTable transposition_table_{default_hash_size_};
   bool use_transposition_table_ = true;
   PositionTable<bool, 16> no_return_table_;
-  std::vector<std::pair<Move, Move>> cut_moves =
-    std::vector<std::pair<Move, Move>>(max_depth_, {kNullMove, kNullMove});
 
   // Batch evaluation.
   int64_t batch_size_ = -1;
   int64_t processed_in_the_batch_;
-  bool proceed_with_batch_value_ = true;
+  // Helper threads stop, once it's false.
+  std::atomic<bool> proceed_with_batch_value_ = true;
   std::function<bool()> proceed_with_batch_ = [](){return true;};
   std::function<
     void(int16_t, int32_t, int64_t, std::list<Move>)
   > report_progress_ = [](int16_t, int32_t, int64_t, std::list<Move>){};
 
   static const int16_t max_depth_ = 1000;
+  static const size_t default_hash_size_ = 128;  // In megabytes.
   static const int32_t lowest_eval_ = -2000000000;
   static const int32_t highest_eval_ = 2000000000;
   static const int32_t longest_checkmate_ = 1000;
+  // Positional gains a capture can bring in addition to the material.
+  static const int32_t delta_margin_ = 2000;
 };
 
 }  // namespace chess_engine
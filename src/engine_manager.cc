@@ -1,5 +1,6 @@
 #include "src/engine_manager.h"
 
+#include <algorithm>
 #include <chrono>
 #include <list>
 
@@ -16,6 +17,10 @@ protocol_(protocol), engine_(engine) {
     [this](const Position& position){SetPosition(position);}
   );
   protocol_->SetSetTimeCallback([this](TimeControl tc){SetTime(tc);});
+  protocol_->SetSetMemoryCallback(
+    [this](int32_t megabytes){SetMemory(megabytes);}
+  );
+  protocol_->SetSetCoresCallback([this](int32_t cores){SetCores(cores);});
 
   engine_->SetProceedWithBatchCallback([this](){return ProceedWithBatch();});
   engine_->SetReportProgressCallback([this](
@@ -62,6 +67,7 @@ void EngineManager::SetEngineColor(Player value) {
 }
 
 void EngineManager::NewGame() {
+  engine_->ClearHash();
   SetPosition(starting_position_);
   SetMode(EngineMode::kPlay);
   SetEngineColor(Opponent(starting_position_.PlayerToMove()));
@@ -87,6 +93,17 @@ void EngineManager::SetTime(TimeControl tc) {
   time_control_ = tc;
 }
 
+void EngineManager::SetMemory(int32_t megabytes) {
+  // The old table is kept, if the new one doesn't fit.
+  engine_->SetHashSize(std::max(megabytes, 1));
+  abort_thinking_ = true;
+}
+
+void EngineManager::SetCores(int32_t cores) {
+  engine_->SetThreadCount(std::max(cores, 1));
+  abort_thinking_ = true;
+}
+
 void EngineManager::MakeMove(Move move) {
   engine_->MakeMove(move);
   game_.MakeMove(move);
@@ -23,6 +23,10 @@ class EngineManager {
   void SetPosition(const Position& Position);
   void SetMode(EngineMode mode);
   void SetTime(TimeControl tc);
+  // Size of the transposition table.
+  void SetMemory(int32_t megabytes);
+  // Number of threads to search with.
+  void SetCores(int32_t cores);
 
   void MakeMove(Move move);
   void UndoMove();
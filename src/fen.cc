@@ -232,51 +232,44 @@ std::string PositionToFen(const Position& position) {
 
 std::string MoveToUci(Move move) {
   std::string ret;
-  ret += CoordinatesToString(move.from) + CoordinatesToString(move.to);
-  if (move.piece != pieces::kNone) {
+  ret += CoordinatesToString(move.GetFrom());
+  ret += CoordinatesToString(move.GetTo());
+  if (move.GetPromotion() != PieceType::kNone) {
     ret += "=";
-    ret += PieceToFen({move.piece.type, Player::kWhite});
+    ret += PieceToFen({move.GetPromotion(), Player::kWhite});
   }
   return ret;
 }
 
 // TODO(Andrey): Fix promotion in UCI.
 Move UciToMove(const std::string& str) {
-  Move ret;
-  ret.from = StringToCoordinates(str);
-  ret.to = StringToCoordinates(str.substr(2));
+  Piece promote_to = pieces::kNone;
   if (str.size() == 6) {
-    ret.piece = FenToPiece(str[5]);
-  } else {
-    ret.piece = pieces::kNone;
+    promote_to = FenToPiece(str[5]);
   }
-  return ret;
+  return {
+    StringToCoordinates(str), StringToCoordinates(str.substr(2)), promote_to
+  };
 }
 
 std::string MoveToXBoard(Move move) {
   std::string ret;
-  ret += CoordinatesToString(move.from) + CoordinatesToString(move.to);
-  if (move.piece != pieces::kNone) {
-    ret += PieceToFen({move.piece.type, Player::kBlack});
+  ret += CoordinatesToString(move.GetFrom());
+  ret += CoordinatesToString(move.GetTo());
+  if (move.GetPromotion() != PieceType::kNone) {
+    ret += PieceToFen({move.GetPromotion(), Player::kBlack});
   }
   return ret;
 }
 
 Move XBoardToMove(const std::string& str) {
-  Move ret;
-  ret.from = StringToCoordinates(str);
-  ret.to = StringToCoordinates(str.substr(2));
+  Piece promote_to = pieces::kNone;
   if (str.size() == 5) {
-    ret.piece = FenToPiece(str[4]);
-    if (ret.to.rank == PromotionRank(Player::kWhite)) {
-      ret.piece.player = Player::kWhite;
-    } else {
-      ret.piece.player = Player::kBlack;
-    }
-  } else {
-    ret.piece = pieces::kNone;
+    promote_to = FenToPiece(str[4]);
   }
-  return ret;
+  return {
+    StringToCoordinates(str), StringToCoordinates(str.substr(2)), promote_to
+  };
 }
 
 }  // namespace chess_engine
@@ -1,27 +1,26 @@
 #include "src/game.h"
 
 #include "src/chess_defines.h"
+#include "src/position_snapshot.h"
 
 namespace chess_engine {
 
 Game::Game(const Position& starting_position):
-  starting_position_(starting_position)
+  position_(starting_position)
 {}
 
 Position Game::GetPosition() {
-  Position position = starting_position_;
-  for (Move move : moves_) {
-    position.MakeMove(move);
-  }
-  return position;
+  return position_;
 }
 
 void Game::MakeMove(Move move) {
-  moves_.push_back(move);
+  history_.push_back(PositionSnapshot(position_));
+  position_.MakeMove(move);
 }
 
 void Game::UndoMove() {
-  moves_.pop_back();
+  position_ = history_.back().ToPosition();
+  history_.pop_back();
 }
 
 }  // namespace chess_engine
@@ -5,6 +5,7 @@
 
 #include "src/chess_defines.h"
 #include "src/position.h"
+#include "src/position_snapshot.h"
 
 namespace chess_engine {
 
@@ -16,8 +17,9 @@ class Game {
   void MakeMove(Move move);
   void UndoMove();
  private:
-  Position starting_position_;
-  std::vector<Move> moves_;
+  Position position_;
+  // Positions before every move, so undo doesn't replay the game.
+  std::vector<PositionSnapshot> history_;
 };
 
 }  // namespace chess_engine
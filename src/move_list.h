@@ -0,0 +1,96 @@
+#ifndef SRC_MOVE_LIST_H_
+#define SRC_MOVE_LIST_H_
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+#include "src/chess_defines.h"
+
+namespace chess_engine {
+
+// Fixed-capacity list of moves, that doesn't allocate memory, so it can
+// live on the stack of a search function. Every move has a score
+// next to it, which is used for move ordering.
+class MoveList {
+ public:
+  // No legal chess position has more moves.
+  static const int kCapacity = 256;
+
+  struct Entry {
+    Move move;
+    int32_t score;
+  };
+
+  void Push(Move move) {
+    assert(size_ < kCapacity);  // Too many moves.
+    entries_[size_] = {move, 0};
+    ++size_;
+  }
+
+  void Clear() {
+    size_ = 0;
+  }
+
+  int Size() const {
+    return size_;
+  }
+
+  bool Empty() const {
+    return size_ == 0;
+  }
+
+  Move GetMove(int index) const {
+    return entries_[index].move;
+  }
+
+  int32_t GetScore(int index) const {
+    return entries_[index].score;
+  }
+
+  void SetScore(int index, int32_t score) {
+    entries_[index].score = score;
+  }
+
+  void Swap(int first, int second) {
+    std::swap(entries_[first], entries_[second]);
+  }
+
+  // Stable insertion sort, highest scores first. Lists are short and
+  // partially ordered by the generators, so it beats std::sort here.
+  void SortByScore() {
+    for (int i = 1; i < size_; ++i) {
+      Entry entry = entries_[i];
+      int j = i;
+      for (; j > 0 && entries_[j-1].score < entry.score; --j) {
+        entries_[j] = entries_[j-1];
+      }
+      entries_[j] = entry;
+    }
+  }
+
+  Entry* begin() {
+    return entries_.data();
+  }
+
+  Entry* end() {
+    return entries_.data() + size_;
+  }
+
+  const Entry* begin() const {
+    return entries_.data();
+  }
+
+  const Entry* end() const {
+    return entries_.data() + size_;
+  }
+
+ private:
+  std::array<Entry, kCapacity> entries_;
+  int size_ = 0;
+};
+
+}  // namespace chess_engine
+
+#endif  // SRC_MOVE_LIST_H_
@@ -0,0 +1,195 @@
+#include "src/move_picker.h"
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "src/chess_defines.h"
+#include "src/move_list.h"
+#include "src/position.h"
+
+namespace chess_engine {
+
+namespace {
+
+// Rough piece values for ordering only, indexed by PieceType.
+// The king is the last piece we want to capture with.
+const std::array<int32_t, 7> kOrderingValues = {0, 1, 5, 3, 3, 9, 20};
+
+int32_t OrderingValue(PieceType type) {
+  return kOrderingValues[static_cast<int>(type)];
+}
+
+}  // namespace
+
+MovePicker::MovePicker(
+  const Position& position,
+  Move hash_move,
+  Move pv_move,
+  std::pair<Move, Move> cut_moves
+):
+  position_(&position),
+  hash_move_(hash_move),
+  pv_move_(pv_move),
+  cut_moves_(cut_moves),
+  stage_(Stage::kHashMove)
+{}
+
+MovePicker::MovePicker(const Position& position):
+  position_(&position),
+  quiets_(false),
+  stage_(Stage::kGenerateCaptures)
+{}
+
+bool MovePicker::GetNextMove(Move* move) {
+  while (true) {
+    switch (stage_) {
+      case Stage::kHashMove:
+        stage_ = Stage::kPVMove;
+        if (position_->MoveIsLegal(hash_move_)) {
+          picked_[picked_count_++] = hash_move_;
+          *move = hash_move_;
+          return true;
+        }
+        break;
+      case Stage::kPVMove:
+        stage_ = Stage::kGenerateCaptures;
+        if (!AlreadyPicked(pv_move_) && position_->MoveIsLegal(pv_move_)) {
+          picked_[picked_count_++] = pv_move_;
+          *move = pv_move_;
+          return true;
+        }
+        break;
+      case Stage::kGenerateCaptures:
+        position_->GeneratePseudoLegalCaptures(&moves_);
+        ScoreCaptures();
+        stage_ = Stage::kCaptures;
+        break;
+      case Stage::kCaptures:
+        while (index_ < moves_.Size()) {
+          Move best = PickBest();
+          int current = index_++;
+          if (AlreadyPicked(best)) {
+            continue;
+          }
+          if (!position_->SeeGE(best, 0)) {
+            // Losing captures are kept at the front of the list.
+            moves_.Swap(bad_captures_++, current);
+            continue;
+          }
+          if (position_->IsLegal(best)) {
+            *move = best;
+            return true;
+          }
+        }
+        // The quiescence search doesn't try losing captures at all.
+        stage_ = quiets_ ? Stage::kFirstCutMove : Stage::kDone;
+        break;
+      case Stage::kFirstCutMove:
+      case Stage::kSecondCutMove: {
+        Move cut_move = stage_ == Stage::kFirstCutMove ?
+          cut_moves_.first : cut_moves_.second;
+        stage_ = stage_ == Stage::kFirstCutMove ?
+          Stage::kSecondCutMove : Stage::kGenerateQuiets;
+        if (
+          !AlreadyPicked(cut_move) &&
+          position_->MoveIsLegal(cut_move) &&
+          !IsTactical(cut_move)
+        ) {
+          picked_[picked_count_++] = cut_move;
+          *move = cut_move;
+          return true;
+        }
+        break;
+      }
+      case Stage::kGenerateQuiets:
+        // Appended after the captures, so losing captures are kept.
+        index_ = moves_.Size();
+        position_->GeneratePseudoLegalQuiets(&moves_);
+        ScoreQuiets();
+        stage_ = Stage::kQuiets;
+        break;
+      case Stage::kQuiets:
+        while (index_ < moves_.Size()) {
+          Move best = PickBest();
+          ++index_;
+          if (!AlreadyPicked(best) && position_->IsLegal(best)) {
+            *move = best;
+            return true;
+          }
+        }
+        index_ = 0;
+        stage_ = Stage::kBadCaptures;
+        break;
+      case Stage::kBadCaptures:
+        while (index_ < bad_captures_) {
+          Move capture = moves_.GetMove(index_);
+          ++index_;
+          if (position_->IsLegal(capture)) {
+            *move = capture;
+            return true;
+          }
+        }
+        stage_ = Stage::kDone;
+        break;
+      case Stage::kDone:
+        return false;
+    }
+  }
+}
+
+bool MovePicker::IsTactical(Move move) const {
+  if (position_->GetSquare(move.GetTo()) != pieces::kNone) {
+    return true;
+  }
+  if (move.GetPromotion() != PieceType::kNone) {
+    return true;
+  }
+  return
+    move.GetTo() == position_->GetEnPessant() &&
+    position_->GetSquare(move.GetFrom()).type == PieceType::kPawn;
+}
+
+bool MovePicker::AlreadyPicked(Move move) const {
+  for (int i = 0; i < picked_count_; ++i) {
+    if (picked_[i] == move) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Move MovePicker::PickBest() {
+  int best = index_;
+  for (int i = index_ + 1; i < moves_.Size(); ++i) {
+    if (moves_.GetScore(i) > moves_.GetScore(best)) {
+      best = i;
+    }
+  }
+  moves_.Swap(index_, best);
+  return moves_.GetMove(index_);
+}
+
+void MovePicker::ScoreCaptures() {
+  for (int i = 0; i < moves_.Size(); ++i) {
+    Move move = moves_.GetMove(i);
+    Piece victim = position_->GetSquare(move.GetTo());
+    Piece attacker = position_->GetSquare(move.GetFrom());
+    // En pessant takes a pawn from an empty square.
+    int32_t gain = victim == pieces::kNone ?
+      OrderingValue(PieceType::kPawn) : OrderingValue(victim.type);
+    if (move.GetPromotion() != PieceType::kNone) {
+      gain = OrderingValue(victim.type) +
+        OrderingValue(move.GetPromotion()) - OrderingValue(PieceType::kPawn);
+    }
+    moves_.SetScore(i, 32*gain - OrderingValue(attacker.type));
+  }
+}
+
+void MovePicker::ScoreQuiets() {
+  for (int i = index_; i < moves_.Size(); ++i) {
+    moves_.SetScore(i, position_->GivesCheck(moves_.GetMove(i)));
+  }
+}
+
+}  // namespace chess_engine
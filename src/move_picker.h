@@ -0,0 +1,81 @@
+#ifndef SRC_MOVE_PICKER_H_
+#define SRC_MOVE_PICKER_H_
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "src/chess_defines.h"
+#include "src/move_list.h"
+#include "src/position.h"
+
+namespace chess_engine {
+
+// Hands out legal moves one by one, generating them in stages.
+// The hash moves come first and are tried before generating anything,
+// then captures from the most valuable victim and least valuable
+// attacker, then cut moves (aka killers), the rest of the quiet moves,
+// checks first, and only then captures, that lose material according
+// to the static exchange evaluation. If the search gets a cutoff early,
+// the later stages are never generated. Generated moves are
+// pseudo-legal and checked for legality only when they are handed out.
+class MovePicker {
+ public:
+  // 'hash_move' and 'pv_move' can be kNullMove or even illegal.
+  MovePicker(
+    const Position& position,
+    Move hash_move,
+    Move pv_move,
+    std::pair<Move, Move> cut_moves
+  );
+  // Only captures and promotions, that don't lose material,
+  // for the quiescence search.
+  explicit MovePicker(const Position& position);
+
+  // Returns false, when there are no moves left.
+  bool GetNextMove(Move* move);
+
+ private:
+  enum struct Stage {
+    kHashMove,
+    kPVMove,
+    kGenerateCaptures,
+    kCaptures,
+    kFirstCutMove,
+    kSecondCutMove,
+    kGenerateQuiets,
+    kQuiets,
+    kBadCaptures,
+    kDone
+  };
+
+  // Captures, en pessant and promotions are searched in their own stage.
+  bool IsTactical(Move move) const;
+  // Whether the move was already handed out by the earlier stages.
+  bool AlreadyPicked(Move move) const;
+  // Moves the best of the remaining moves to 'index_' and returns it.
+  Move PickBest();
+
+  void ScoreCaptures();
+  // Scores moves from 'index_' to the end.
+  void ScoreQuiets();
+
+  const Position* position_ = nullptr;
+  Move hash_move_ = kNullMove;
+  Move pv_move_ = kNullMove;
+  std::pair<Move, Move> cut_moves_ = {kNullMove, kNullMove};
+  bool quiets_ = true;  // Whether to go past the captures.
+  // Moves from the first stages, which were legal and handed out.
+  std::array<Move, 4> picked_ = {};
+  int picked_count_ = 0;
+
+  Stage stage_;
+  MoveList moves_;
+  int index_ = 0;
+  // Losing captures are moved to the front of moves_.
+  int bad_captures_ = 0;
+};
+
+}  // namespace chess_engine
+
+#endif  // SRC_MOVE_PICKER_H_
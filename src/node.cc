@@ -9,12 +9,16 @@
 namespace chess_engine {
 
 Node::Node(const ZobristHashFunction& hash_func):
-  hash_(hash_func)
-{}
+  hash_function_(&hash_func)
+{
+  position_.SetHashFunction(hash_function_);
+}
 
 Node::Node(const Position& position, const ZobristHashFunction& func):
-  position_(position), hash_(position, func)
-{}
+  hash_function_(&func), position_(position)
+{
+  position_.SetHashFunction(hash_function_);
+}
 
 bool Node::IsCheck() const {
   return position_.IsCheck();
@@ -28,174 +32,83 @@ bool Node::IsStalemate() const {
   return position_.IsStalemate();
 }
 
+bool Node::IsInsufficientMaterial() const {
+  return position_.IsInsufficientMaterial();
+}
+
 Player Node::PlayerToMove() const {
   return position_.PlayerToMove();
 }
 
 void Node::SetPlayerToMove(Player player) {
-  if (player != position_.PlayerToMove()) {
-    hash_.PassTheTurn();
-  }
   position_.SetPlayerToMove(player);
 }
 
 void Node::PassTheTurn() {
   position_.PassTheTurn();
-  hash_.PassTheTurn();
 }
 
-bool Node::MoveIsCheckFast(Move move) const {
-  return position_.MoveIsCheckFast(move);
+bool Node::GivesCheck(Move move) const {
+  return position_.GivesCheck(move);
 }
 
 std::vector<Move> Node::GetLegalMoves() const {
   return position_.GetLegalMoves();
 }
 
+void Node::GetLegalMoves(MoveList* out) const {
+  position_.GetLegalMoves(out);
+}
+
 std::vector<Move> Node::GetCapturesOnSquare(
   Coordinates square, Player player
 ) const {
   return position_.GetCapturesOnSquare(square, player);
 }
 
-void Node::MakeMove(Move move) {
-  HashMove(&hash_, move);
-  if (move == kNullMove) {
-    last_capture_ = {-1, -1};
-    position_.PassTheTurn();
-    return;
-  }
-  if (position_.GetSquare(move.to) != pieces::kNone) {
-    last_capture_ = move.to;
-  } else {
-    last_capture_ = {-1, -1};
-  }
-  position_.MakeMove(move);
+void Node::GetCapturesOnSquare(
+  Coordinates square, Player player, MoveList* out
+) const {
+  position_.GetCapturesOnSquare(square, player, out);
 }
 
-void Node::HashMove(ZobristHash* hash, Move move) const {
-  if (move.piece == pieces::kNone) {
-    move.piece = GetSquare(move.from);
-  }
-  Piece old_piece = position_.GetSquare(move.from);
-
-  int8_t dir = PawnDirection(position_.PlayerToMove());
-  Coordinates en_pessant = position_.GetEnPessant();
-  Player to_move = position_.PlayerToMove();
-
-  bool normal_move = true;
-
-  // En pessant.
-  if (move.to == en_pessant && move.piece.type == PieceType::kPawn) {
-    Coordinates taken = move.to;
-    taken.rank -= dir;
-    hash->ToggleSquare(taken, {PieceType::kPawn, Opponent(to_move)});
-    hash->ToggleSquare(move.from, {PieceType::kPawn, to_move});
-    hash->ToggleSquare(move.to, {PieceType::kPawn, to_move});
-    normal_move = false;
-  }
-
-  // Castling.
-  if (move.piece.type == PieceType::kKing) {
-    if (move.to == move.from + Coordinates{2, 0}) {
-      hash->ToggleSquare(
-        move.from, {PieceType::kKing, to_move}
-      );
-      hash->ToggleSquare(
-        move.from + Coordinates{3, 0}, {PieceType::kRook, to_move}
-      );
-      hash->ToggleSquare(
-        move.to, {PieceType::kKing, to_move}
-      );
-      hash->ToggleSquare(
-        move.to + Coordinates{-1, 0}, {PieceType::kRook, to_move}
-      );
-      normal_move = false;
-    }
-    if (move.to == move.from + Coordinates{-2, 0}) {
-      hash->ToggleSquare(
-        move.from, {PieceType::kKing, to_move}
-      );
-      hash->ToggleSquare(
-        move.from + Coordinates{-4, 0}, {PieceType::kRook, to_move}
-      );
-      hash->ToggleSquare(
-        move.to, {PieceType::kKing, to_move}
-      );
-      hash->ToggleSquare(
-        move.to + Coordinates{1, 0}, {PieceType::kRook, to_move}
-      );
-      normal_move = false;
-    }
-  }
-
-  if (normal_move) {
-    Piece taken = position_.GetSquare(move.to);
-    hash->ToggleSquare(move.from, move.piece);
-    hash->ToggleSquare(move.to, taken);
-    hash->ToggleSquare(move.to, move.piece);
-  }
-
-  // Update en-pessant.
-  hash->ToggleEnPessant(en_pessant);
-  if (
-    move.piece.type == PieceType::kPawn &&
-    move.to.rank - move.from.rank == dir*2
-  ) {
-    Coordinates new_en_pessant = move.from;
-    new_en_pessant.rank += dir;
-    hash->ToggleEnPessant(new_en_pessant);
-  }
-
-  // Update castling rights due to rook moves/captures.
-  if (move.from == Coordinates{0, 0} || move.to == Coordinates{0, 0}) {
-    if (position_.GetCastlingRights(Player::kWhite, Castle::kQueenside)) {
-      hash->ToggleCastlingRights(Player::kWhite, Castle::kQueenside);
-    }
-  }
-  if (move.from == Coordinates{7, 0} || move.to == Coordinates{7, 0}) {
-    if (position_.GetCastlingRights(Player::kWhite, Castle::kKingside)) {
-      hash->ToggleCastlingRights(Player::kWhite, Castle::kKingside);
-    }
-  }
-  if (move.from == Coordinates{0, 7} || move.to == Coordinates{0, 7}) {
-    if (position_.GetCastlingRights(Player::kBlack, Castle::kQueenside)) {
-      hash->ToggleCastlingRights(Player::kBlack, Castle::kQueenside);
-    }
-  }
-  if (move.from == Coordinates{7, 7} || move.to == Coordinates{7, 7}) {
-    if (position_.GetCastlingRights(Player::kBlack, Castle::kKingside)) {
-      hash->ToggleCastlingRights(Player::kBlack, Castle::kKingside);
-    }
-  }
+void Node::MakeMove(Move move) {
+  undo_stack_.emplace_back();
+  UndoInfo& undo = undo_stack_.back();
+  undo.last_capture = last_capture_;
+  UpdateLastCapture(move);
+  position_.MakeMove(move, &undo.position);
+}
 
+uint64_t Node::GetHashAfterMove(Move move) const {
+  return position_.GetKeyAfterMove(move);
+}
 
-  // Update castling rights due to king moves.
-  if (move.piece == pieces::kWhiteKing) {
-    if (position_.GetCastlingRights(Player::kWhite, Castle::kQueenside)) {
-      hash->ToggleCastlingRights(Player::kWhite, Castle::kQueenside);
-    }
-    if (position_.GetCastlingRights(Player::kWhite, Castle::kKingside)) {
-      hash->ToggleCastlingRights(Player::kWhite, Castle::kKingside);
-    }
-  }
+void Node::UnmakeMove() {
+  const UndoInfo& undo = undo_stack_.back();
+  position_.UnmakeMove(undo.position);
+  last_capture_ = undo.last_capture;
+  undo_stack_.pop_back();
+}
 
-  if (move.piece == pieces::kBlackKing) {
-    if (position_.GetCastlingRights(Player::kBlack, Castle::kQueenside)) {
-      hash->ToggleCastlingRights(Player::kBlack, Castle::kQueenside);
-    }
-    if (position_.GetCastlingRights(Player::kBlack, Castle::kKingside)) {
-      hash->ToggleCastlingRights(Player::kBlack, Castle::kKingside);
-    }
-  }
+void Node::MakeIrreversibleMove(Move move) {
+  undo_stack_.clear();
+  UpdateLastCapture(move);
+  position_.MakeMove(move);
+}
 
-  hash->PassTheTurn();
+size_t Node::GetUndoDepth() const {
+  return undo_stack_.size();
 }
 
-ZobristHash Node::HashAfterMove(Move move) const {
-  ZobristHash ret = hash_;
-  HashMove(&ret, move);
-  return ret;
+void Node::UpdateLastCapture(Move move) {
+  if (move == kNullMove) {
+    last_capture_ = {-1, -1};
+  } else if (position_.GetSquare(move.GetTo()) != pieces::kNone) {
+    last_capture_ = move.GetTo();
+  } else {
+    last_capture_ = {-1, -1};
+  }
 }
 
 Piece Node::GetSquare(Coordinates square) const {
@@ -203,10 +116,6 @@ Piece Node::GetSquare(Coordinates square) const {
 }
 
 void Node::SetSquare(Coordinates square, Piece piece) {
-  Piece old_piece = position_.GetSquare(square);
-  hash_.ToggleSquare(square, old_piece);
-  hash_.ToggleSquare(square, piece);
-
   position_.SetSquare(square, piece);
 }
 
@@ -215,11 +124,6 @@ bool Node::GetCastlingRights(Player player, Castle castle) const {
 }
 
 void Node::SetCastlingRights(Player player, Castle castle, bool value) {
-  if (position_.GetCastlingRights(player, castle) == value) {
-    return;
-  }
-  // We now know that the rights have changed.
-  hash_.ToggleCastlingRights(player, castle);
   position_.SetCastlingRights(player, castle, value);
 }
 
@@ -228,9 +132,6 @@ Coordinates Node::GetEnPessant() const {
 }
 
 void Node::SetEnPessant(Coordinates square) {
-  Coordinates old_square = position_.GetEnPessant();
-  hash_.ToggleEnPessant(old_square);
-  hash_.ToggleEnPessant(square);
   position_.SetEnPessant(square);
 }
 
@@ -266,14 +167,23 @@ Coordinates Node::GetLastCapture() const {
   return last_capture_;
 }
 
-ZobristHash Node::GetHash() const {
-  return hash_;
+uint64_t Node::GetHash() const {
+  return position_.GetKey();
+}
+
+uint64_t Node::GetPawnHash() const {
+  return position_.GetPawnKey();
+}
+
+uint64_t Node::GetMaterialHash() const {
+  return position_.GetMaterialKey();
 }
 
 void Node::SetPosition(const Position& position) {
   position_ = position;
   last_capture_ = {-1, -1};
-  hash_.RecalculateForPosition(position);
+  undo_stack_.clear();
+  position_.SetHashFunction(hash_function_);
 }
 
 const Position& Node::GetPosition() const {
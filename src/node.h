@@ -1,42 +1,59 @@
 #ifndef SRC_NODE_H_
 #define SRC_NODE_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include "src/chess_defines.h"
+#include "src/move_list.h"
 #include "src/position.h"
 #include "src/zobrist_hash.h"
 
 namespace chess_engine {
 
 // Represents a node in the search tree.
-// Has position functionality, but also handles hash.
+// Has position functionality, and keeps the hash of the position.
 class Node {
  public:
-  explicit Node(const ZobristHashFunction& hash_func);
-  Node(const Position& position, const ZobristHashFunction& func);
+  // The hash function must outlive the node.
+  explicit Node(const ZobristHashFunction& hash_func = kZobristHash);
+  explicit Node(
+    const Position& position,
+    const ZobristHashFunction& func = kZobristHash
+  );
 
   bool IsCheck() const;
   bool IsCheckmate() const;
   bool IsStalemate() const;
+  bool IsInsufficientMaterial() const;
 
   // Whose turn it is.
   Player PlayerToMove() const;
   void SetPlayerToMove(Player player);
   void PassTheTurn();
 
-  bool MoveIsCheckFast(Move move) const;
+  bool GivesCheck(Move move) const;
   std::vector<Move> GetLegalMoves() const;
+  void GetLegalMoves(MoveList* out) const;
   std::vector<Move> GetCapturesOnSquare(
     Coordinates square, Player player
   ) const;
+  void GetCapturesOnSquare(
+    Coordinates square, Player player, MoveList* out
+  ) const;
 
   void MakeMove(Move move);
-
-  // Incrementaly update hash after a move in a current position.
-  void HashMove(ZobristHash* hash, Move move) const;
-  // Somewhat similar to MakeMove, but only for hash.
-  ZobristHash HashAfterMove(Move move) const;
+  // Hash of the position after the move, without making it.
+  uint64_t GetHashAfterMove(Move move) const;
+  // Takes back the last move made with MakeMove.
+  void UnmakeMove();
+  // Makes the move for good: neither it, nor the moves before it can be
+  // taken back. Keeps no undo information, so game moves made on the
+  // root don't pile up.
+  void MakeIrreversibleMove(Move move);
+  // Number of moves, that can be taken back.
+  size_t GetUndoDepth() const;
 
   Piece GetSquare(int file, int rank) const;
   Piece GetSquare(Coordinates square) const;
@@ -60,14 +77,25 @@ class Node {
 
   Coordinates GetLastCapture() const;
 
-  ZobristHash GetHash() const;
+  uint64_t GetHash() const;
+  uint64_t GetPawnHash() const;
+  uint64_t GetMaterialHash() const;
   void SetPosition(const Position& position);
   const Position& GetPosition() const;
 
  private:
-  ZobristHash hash_;
+  void UpdateLastCapture(Move move);
+
+  // Position's undo information, plus what the node adds on top of it.
+  struct UndoInfo {
+    Position::UndoInfo position;
+    Coordinates last_capture;
+  };
+
+  const ZobristHashFunction* hash_function_;
   Position position_;
   Coordinates last_capture_ = {-1, -1};
+  std::vector<UndoInfo> undo_stack_;
 };
 
 }  // namespace chess_engine
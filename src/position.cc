@@ -1,23 +1,134 @@
 #include "src/position.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstdint>
+#include <vector>
 
+#include "src/bitboard.h"
 #include "src/chess_defines.h"
+#include "src/move_list.h"
+#include "src/zobrist_hash.h"
 
 namespace chess_engine {
 
+namespace {
+
+// Thin layer over SIMD registers, holding 16 int8_t values.
+// Platforms without SSE2 or NEON use the scalar code instead.
+#if defined(__SSE2__)
+#define CHESS_ENGINE_VECTOR_ATTACKS
+
+using AttackVector = __m128i;
+
+AttackVector LoadVector(const void* source) {
+  return _mm_loadu_si128(static_cast<const __m128i*>(source));
+}
+
+void StoreVector(void* destination, AttackVector vector) {
+  _mm_storeu_si128(static_cast<__m128i*>(destination), vector);
+}
+
+AttackVector AddVectors(AttackVector first, AttackVector second) {
+  return _mm_add_epi8(first, second);
+}
+
+AttackVector NegateVector(AttackVector vector) {
+  return _mm_sub_epi8(_mm_setzero_si128(), vector);
+}
+
+// SSE2 can only multiply 16-bit lanes, so even and odd bytes are
+// multiplied separately. Low bytes of the products are correct anyway.
+AttackVector MultiplyVectors(AttackVector first, AttackVector second) {
+  __m128i even = _mm_mullo_epi16(first, second);
+  __m128i odd = _mm_mullo_epi16(
+    _mm_srli_epi16(first, 8), _mm_srli_epi16(second, 8)
+  );
+  return _mm_or_si128(
+    _mm_and_si128(even, _mm_set1_epi16(0xFF)), _mm_slli_epi16(odd, 8)
+  );
+}
+#elif defined(__ARM_NEON)
+#define CHESS_ENGINE_VECTOR_ATTACKS
+
+using AttackVector = int8x16_t;
+
+AttackVector LoadVector(const void* source) {
+  return vld1q_s8(static_cast<const int8_t*>(source));
+}
+
+void StoreVector(void* destination, AttackVector vector) {
+  vst1q_s8(static_cast<int8_t*>(destination), vector);
+}
+
+AttackVector AddVectors(AttackVector first, AttackVector second) {
+  return vaddq_s8(first, second);
+}
+
+AttackVector NegateVector(AttackVector vector) {
+  return vnegq_s8(vector);
+}
+
+AttackVector MultiplyVectors(AttackVector first, AttackVector second) {
+  return vmulq_s8(first, second);
+}
+#endif
+
+// Values for the static exchange evaluation, indexed by PieceType,
+// in the same units as the evaluation. The king is never captured.
+const std::array<int32_t, 7> kExchangeValues = {
+  0, 1000, 5000, 3000, 3000, 9000, 0
+};
+
+int32_t ExchangeValue(PieceType type) {
+  return kExchangeValues[static_cast<int>(type)];
+}
+
+// Pieces from the least valuable to the most valuable.
+const std::array<PieceType, 6> kCheapestFirst = {
+  PieceType::kPawn, PieceType::kKnight, PieceType::kBishop,
+  PieceType::kRook, PieceType::kQueen, PieceType::kKing
+};
+
+}  // namespace
+
 bool Position::IsCheck() const {
   return GetChecks(to_move_) > 0;
 }
 
 bool Position::IsCheckmate() const {
-  return IsCheck() && GetLegalMoves().empty();
+  return IsCheck() && !HasLegalMoves();
 }
 
 bool Position::IsStalemate() const {
-  return !IsCheck() && GetLegalMoves().empty();
+  return !IsCheck() && !HasLegalMoves();
+}
+
+bool Position::IsInsufficientMaterial() const {
+  if (
+    piece_bitboards_[static_cast<int>(PieceType::kPawn)] ||
+    piece_bitboards_[static_cast<int>(PieceType::kRook)] ||
+    piece_bitboards_[static_cast<int>(PieceType::kQueen)]
+  ) {
+    return false;
+  }
+  Bitboard knights = piece_bitboards_[static_cast<int>(PieceType::kKnight)];
+  Bitboard bishops = piece_bitboards_[static_cast<int>(PieceType::kBishop)];
+  // A single minor piece can't checkmate.
+  if (CountSquares(knights | bishops) <= 1) {
+    return true;
+  }
+  // Neither can any number of bishops, all on squares of the same color.
+  return
+    !knights &&
+    (!(bishops & kDarkSquares) || !(bishops & ~kDarkSquares));
 }
 
 Player Position::PlayerToMove() const {
@@ -25,177 +136,386 @@ Player Position::PlayerToMove() const {
 }
 
 void Position::SetPlayerToMove(Player player) {
+  if (player != to_move_ && hash_function_) {
+    key_ ^= hash_function_->HashTurn();
+  }
   to_move_ = player;
-  moves_generated_ = false;
 }
 
 void Position::PassTheTurn() {
+  if (hash_function_) {
+    key_ ^= hash_function_->HashTurn();
+  }
   if (to_move_ == Player::kWhite) {
     to_move_ = Player::kBlack;
   } else {
     ++move_number_;
     to_move_ = Player::kWhite;
   }
-  UpdateCheckSegment();
 }
 
-void Position::MakeMove(Move move) {
-  if (move.piece == pieces::kNone) {
-    move.piece = GetSquare(move.from);
+void Position::MakeMove(Move move, UndoInfo* undo) {
+  MoveEffects effects = GetMoveEffects(move);
+  if (undo) {
+    for (int8_t i = 0; i < effects.size; ++i) {
+      undo->squares[i] = effects.squares[i];
+      undo->pieces[i] = GetSquare(effects.squares[i]);
+    }
+    undo->size = effects.size;
+    undo->en_pessant = en_pessant_;
+    undo->halfmove_clock = halfmove_clock_;
+    undo->castling_rights = GetCastlingRightsBits();
+    undo->key = key_;
+    undo->pawn_key = pawn_key_;
+    undo->material_key = material_key_;
   }
 
-  // If move is legal it deals with all checks.
-  check_segment_ = {{-1, -1}, {-1, -1}};
-  if (
-    GetSquare(move.from).type == PieceType::kPawn ||
-    GetSquare(move.to) != pieces::kNone
-  ) {
+  // Checks and pins are updated inside the SetSquare function.
+  for (int8_t i = 0; i < effects.size; ++i) {
+    SetSquare(effects.squares[i], effects.pieces[i]);
+  }
+  if (effects.resets_halfmove_clock) {
     halfmove_clock_ = 0;
   } else {
     ++halfmove_clock_;
   }
+  SetEnPessant(effects.en_pessant);
+  for (int bit = 0; bit < 4; ++bit) {
+    if (effects.lost_castling_rights & 1 << bit) {
+      SetCastlingRights(CastlingBitPlayer(bit), CastlingBitSide(bit), false);
+    }
+  }
+  PassTheTurn();
+}
+
+Position::MoveEffects Position::GetMoveEffects(Move move) const {
+  MoveEffects ret;
+  if (move == kNullMove) {
+    return ret;
+  }
+
+  Coordinates from = move.GetFrom();
+  Coordinates to = move.GetTo();
+  Piece moved = GetSquare(from);
+  // Piece that ends up on the destination square.
+  Piece piece = moved;
+  if (
+    moved.type == PieceType::kPawn &&
+    move.GetPromotion() != PieceType::kNone
+  ) {
+    piece = {move.GetPromotion(), to_move_};
+  }
+  ret.resets_halfmove_clock =
+    moved.type == PieceType::kPawn || GetSquare(to) != pieces::kNone;
+  ret.Add(from, pieces::kNone);
 
   // En pessant.
   int8_t dir = PawnDirection(to_move_);
-  if (move.to == en_pessant_ && move.piece.type == PieceType::kPawn) {
-    Coordinates taken = move.to;
+  if (to == en_pessant_ && moved.type == PieceType::kPawn) {
+    Coordinates taken = to;
     taken.rank -= dir;
-    SetSquare(taken, pieces::kNone);
-    SetSquare(move.from, pieces::kNone);
-    SetSquare(move.to, move.piece);
-    halfmove_clock_ = 0;
+    ret.Add(taken, pieces::kNone);
   }
 
   // Castling.
-  if (move.piece.type == PieceType::kKing) {
-    if (move.to == move.from + Coordinates{2, 0}) {
-      SetSquare(move.from, pieces::kNone);
-      SetSquare(move.from + Coordinates{3, 0}, pieces::kNone);
-      SetSquare(move.to, {PieceType::kKing, to_move_});
-      SetSquare(move.to + Coordinates{-1, 0}, {PieceType::kRook, to_move_});
+  if (moved.type == PieceType::kKing) {
+    if (to == from + Coordinates{2, 0}) {
+      ret.Add(from + Coordinates{3, 0}, pieces::kNone);
+      ret.Add(to + Coordinates{-1, 0}, {PieceType::kRook, to_move_});
     }
-    if (move.to == move.from + Coordinates{-2, 0}) {
-      SetSquare(move.from, pieces::kNone);
-      SetSquare(move.from + Coordinates{-4, 0}, pieces::kNone);
-      SetSquare(move.to, {PieceType::kKing, to_move_});
-      SetSquare(move.to + Coordinates{1, 0}, {PieceType::kRook, to_move_});
+    if (to == from + Coordinates{-2, 0}) {
+      ret.Add(from + Coordinates{-4, 0}, pieces::kNone);
+      ret.Add(to + Coordinates{1, 0}, {PieceType::kRook, to_move_});
     }
   }
-
-  // Checks and pins are updated inside the SetSquare function.
-  SetSquare(move.from, pieces::kNone);
-  SetSquare(move.to, move.piece);
+  ret.Add(to, piece);
 
   // Update en-pessant.
   if (
-    move.piece.type == PieceType::kPawn &&
-    move.to.rank - move.from.rank == dir*2
+    moved.type == PieceType::kPawn &&
+    to.rank - from.rank == dir*2
   ) {
-    Coordinates new_en_pessant = move.from;
-    new_en_pessant.rank += dir;
-    SetEnPessant(new_en_pessant);
-  } else {
-    SetEnPessant({-1, -1});
+    ret.en_pessant = from;
+    ret.en_pessant.rank += dir;
   }
 
   // Update castling rights due to rook moves/captures.
-  if (move.from == Coordinates{0, 0} || move.to == Coordinates{0, 0}) {
-    SetCastlingRights(Player::kWhite, Castle::kQueenside, false);
-  }
-  if (move.from == Coordinates{7, 0} || move.to == Coordinates{7, 0}) {
-    SetCastlingRights(Player::kWhite, Castle::kKingside, false);
-  }
-  if (move.from == Coordinates{0, 7} || move.to == Coordinates{0, 7}) {
-    SetCastlingRights(Player::kBlack, Castle::kQueenside, false);
+  for (Coordinates square : {from, to}) {
+    if (square == Coordinates{7, 0}) {
+      ret.lost_castling_rights |= 1;
+    } else if (square == Coordinates{0, 0}) {
+      ret.lost_castling_rights |= 2;
+    } else if (square == Coordinates{7, 7}) {
+      ret.lost_castling_rights |= 4;
+    } else if (square == Coordinates{0, 7}) {
+      ret.lost_castling_rights |= 8;
+    }
   }
-  if (move.from == Coordinates{7, 7} || move.to == Coordinates{7, 7}) {
-    SetCastlingRights(Player::kBlack, Castle::kKingside, false);
+  // Upadate castling right due to king moves.
+  if (moved == pieces::kWhiteKing) {
+    ret.lost_castling_rights |= 3;
+  } else if (moved == pieces::kBlackKing) {
+    ret.lost_castling_rights |= 12;
   }
+  ret.lost_castling_rights &= GetCastlingRightsBits();
+  return ret;
+}
 
-  // Upadate castling right due to king moves.
-  if (move.piece == pieces::kWhiteKing) {
-    SetCastlingRights(Player::kWhite, Castle::kQueenside, false);
-    SetCastlingRights(Player::kWhite, Castle::kKingside, false);
+void Position::MoveEffects::Add(Coordinates square, Piece piece) {
+  squares[size] = square;
+  pieces[size] = piece;
+  ++size;
+}
+
+Player Position::CastlingBitPlayer(int bit) {
+  return bit < 2 ? Player::kWhite : Player::kBlack;
+}
+
+Castle Position::CastlingBitSide(int bit) {
+  return bit % 2 ? Castle::kQueenside : Castle::kKingside;
+}
+
+void Position::UnmakeMove(const UndoInfo& undo) {
+  if (to_move_ == Player::kWhite) {
+    --move_number_;
   }
-  if (move.piece == pieces::kBlackKing) {
-    SetCastlingRights(Player::kBlack, Castle::kQueenside, false);
-    SetCastlingRights(Player::kBlack, Castle::kKingside, false);
+  to_move_ = Opponent(to_move_);
+
+  // Keys are restored below, only attacks need updating.
+  for (int8_t i = undo.size - 1; i >= 0; --i) {
+    UpdateSquare(undo.squares[i], undo.pieces[i]);
   }
 
-  PassTheTurn();
+  en_pessant_ = undo.en_pessant;
+  halfmove_clock_ = undo.halfmove_clock;
+  SetCastlingRightsBits(undo.castling_rights);
+  key_ = undo.key;
+  pawn_key_ = undo.pawn_key;
+  material_key_ = undo.material_key;
 }
 
 std::vector<Move> Position::GetLegalMoves() const {
-  if (!moves_generated_) {
-    legal_moves_.clear();
-    GenerateMoves();
-    moves_generated_ = true;
+  MoveList moves;
+  GetLegalMoves(&moves);
+  std::vector<Move> ret;
+  ret.reserve(moves.Size());
+  for (const MoveList::Entry& entry : moves) {
+    ret.push_back(entry.move);
   }
-  return legal_moves_;
+  return ret;
+}
+
+void Position::GetLegalMoves(MoveList* out) const {
+  out->Clear();
+  GenerateMoves(MoveKind::kAll, false, out);
+}
+
+void Position::GenerateCaptures(MoveList* out) const {
+  GenerateMoves(MoveKind::kCaptures, false, out);
+}
+
+void Position::GenerateQuiets(MoveList* out) const {
+  GenerateMoves(MoveKind::kQuiets, false, out);
+}
+
+void Position::GeneratePseudoLegalCaptures(MoveList* out) const {
+  GenerateMoves(MoveKind::kCaptures, true, out);
+}
+
+void Position::GeneratePseudoLegalQuiets(MoveList* out) const {
+  GenerateMoves(MoveKind::kQuiets, true, out);
+}
+
+bool Position::HasLegalMoves() const {
+  MoveList moves;
+  GenerateMoves(MoveKind::kAll, false, &moves);
+  return !moves.Empty();
 }
 
 bool Position::MoveIsLegal(Move move) const {
-  // TODO(Andrey): Implement
+  return MoveIsPseudoLegal(move) && IsLegal(move);
 }
 
-bool Position::MoveIsCheckFast(Move move) const {
-  move.piece = GetSquare(move.from);
-  Pins pins = GetPins(move.from, Opponent(to_move_));
-  bool pin = pins.vertical || pins.upward || pins.horisontal || pins.downward;
-  AttackInfo check_info = checking_squares_[move.to.file][move.to.rank];
+bool Position::MoveIsPseudoLegal(Move move) const {
+  if (move == kNullMove || halfmove_clock_ == 100) {
+    return false;
+  }
+  int8_t from = move.GetFromIndex();
+  int8_t to = move.GetToIndex();
+  Piece piece = GetSquare(move.GetFrom());
+  Bitboard own = player_bitboards_[static_cast<int>(to_move_)];
+  if (piece.player != to_move_ || (own & SquareBitboard(to))) {
+    return false;
+  }
+  bool promotes =
+    piece.type == PieceType::kPawn && to >> 3 == PromotionRank(to_move_);
+  if (promotes != (move.GetPromotion() != PieceType::kNone)) {
+    return false;
+  }
 
-  int8_t Attacks::* by_king = (
-    to_move_ == Player::kWhite?
-    &Attacks::by_black:
-    &Attacks::by_white
-  );
-  bool rook_check =
-  check_info.up.*by_king || check_info.right.*by_king ||
-  check_info.down.*by_king || check_info.left.*by_king;
-  bool bishop_check =
-  check_info.up_right.*by_king || check_info.down_right.*by_king ||
-  check_info.down_left.*by_king || check_info.up_left.*by_king;
-  Coordinates king = GetKing(Opponent(to_move_));
-
-  // TODO(Andrey): King discoveries!
-  int8_t dir = PawnDirection(to_move_);
-  switch (move.piece.type) {
-    case (PieceType::kPawn):
+  Bitboard occupied = GetOccupied();
+  Bitboard enemies = player_bitboards_[static_cast<int>(Opponent(to_move_))];
+  if (piece.type == PieceType::kKing) {
+    if (KingAttacks(from) & SquareBitboard(to)) {
+      return true;
+    }
+    if (to >> 3 != from >> 3) {
+      return false;
+    }
+    if (to == from + 2) {
+      return CastleIsPossible(Castle::kKingside);
+    }
+    if (to == from - 2) {
+      return CastleIsPossible(Castle::kQueenside);
+    }
+    return false;
+  }
+
+  Bitboard destinations = 0;
+  switch (piece.type) {
+    case PieceType::kPawn: {
+      int8_t forward = 8*PawnDirection(to_move_);
+      if (to == from + forward && !(occupied & SquareBitboard(to))) {
+        destinations = SquareBitboard(to);
+      }
       if (
-        move.to + Coordinates{1, dir} == king ||
-        move.to + Coordinates{-1, dir} == king
+        to == from + 2*forward && from >> 3 == DoubleJumpRank(to_move_) &&
+        !(occupied & (SquareBitboard(to) | SquareBitboard(from + forward)))
       ) {
+        destinations = SquareBitboard(to);
+      }
+      destinations |= PawnAttacks(to_move_, from) & enemies;
+      if (move.GetTo() == en_pessant_) {
+        destinations |= PawnAttacks(to_move_, from) & SquareBitboard(to);
+      }
+      break;
+    }
+    case PieceType::kKnight:
+      destinations = KnightAttacks(from);
+      break;
+    case PieceType::kBishop:
+      destinations = BishopAttacks(from, occupied);
+      break;
+    case PieceType::kRook:
+      destinations = RookAttacks(from, occupied);
+      break;
+    case PieceType::kQueen:
+      destinations = QueenAttacks(from, occupied);
+      break;
+    default:
+      return false;
+  }
+  return destinations & SquareBitboard(to);
+}
+
+bool Position::IsLegal(Move move) const {
+  if (to_move_ == Player::kWhite) {
+    return IsLegal<Player::kWhite>(move);
+  }
+  return IsLegal<Player::kBlack>(move);
+}
+
+template<Player us>
+bool Position::IsLegal(Move move) const {
+  constexpr Player them = Opponent(us);
+  int8_t from = move.GetFromIndex();
+  int8_t to = move.GetToIndex();
+  Piece piece = board_[from];
+  if (piece.type == PieceType::kKing) {
+    if (!(KingAttacks(from) & SquareBitboard(to))) {
+      return true;  // Castles are only generated legal.
+    }
+    // Attacks go through the king, so retreating along the line is covered.
+    return !GetAttacksBy<them>(to);
+  }
+  if (piece.type == PieceType::kPawn && move.GetTo() == en_pessant_) {
+    return EnPessantIsLegal(from);
+  }
+  int8_t king = SquareIndex(GetKing(us));
+  if (!GetAttacksBy<them>(king) && !Line(king, from)) {
+    return true;  // Can't be pinned.
+  }
+  // Look for attackers, that would be left after the move.
+  Bitboard occupied =
+    (GetOccupied() ^ SquareBitboard(from)) | SquareBitboard(to);
+  Bitboard attackers =
+    GetAttackers(king, occupied) &
+    player_bitboards_[static_cast<int>(them)] &
+    ~SquareBitboard(to);
+  return !attackers;
+}
+
+bool Position::GivesCheck(Move move) const {
+  if (to_move_ == Player::kWhite) {
+    return GivesCheck<Player::kWhite>(move);
+  }
+  return GivesCheck<Player::kBlack>(move);
+}
+
+template<Player us>
+bool Position::GivesCheck(Move move) const {
+  int8_t from = move.GetFromIndex();
+  int8_t to = move.GetToIndex();
+  int8_t king = SquareIndex(GetKing(Opponent(us)));
+  PieceType type = move.GetPromotion() != PieceType::kNone ?
+    move.GetPromotion() :
+    board_[from].type;
+
+  // The board and our sliders, as they are after the move.
+  Bitboard occupied =
+    (GetOccupied() ^ SquareBitboard(from)) | SquareBitboard(to);
+  Bitboard queens = GetPieces(PieceType::kQueen, us);
+  Bitboard diagonal =
+    (GetPieces(PieceType::kBishop, us) | queens) & ~SquareBitboard(from);
+  Bitboard straight =
+    (GetPieces(PieceType::kRook, us) | queens) & ~SquareBitboard(from);
+  switch (type) {
+    case PieceType::kPawn:
+      if (move.GetTo() == en_pessant_) {
+        // The taken pawn may have been the last blocker.
+        occupied ^= SquareBitboard(to - 8*PawnDirection(us));
+      }
+      if (PawnAttacks(us, to) & SquareBitboard(king)) {
         return true;
       }
-      if (
-        move.to == move.from + Coordinates{0, dir} &&
-        (pins.upward || pins.horisontal || pins.downward)
-      ) {
+      break;
+    case PieceType::kKnight:
+      if (KnightAttacks(to) & SquareBitboard(king)) {
         return true;
       }
-      return false;
-      // We assume promotions always happen on the back rank.
-    break;
-    case (PieceType::kRook):
-      // Don't need to check the direction of the pin,
-      // because we assume the position is legal.
-      return pin || rook_check;
-    break;
-    case (PieceType::kKnight):
-      return pin || KnightMoveAway(move.to, king);
-    break;
-    case (PieceType::kBishop):
-      return pin || bishop_check;
-    break;
-    case (PieceType::kQueen):
-      return pin || rook_check || bishop_check;
-    break;
+      break;
+    case PieceType::kBishop:
+      diagonal |= SquareBitboard(to);
+      break;
+    case PieceType::kRook:
+      straight |= SquareBitboard(to);
+      break;
+    case PieceType::kQueen:
+      diagonal |= SquareBitboard(to);
+      straight |= SquareBitboard(to);
+      break;
+    case PieceType::kKing:
+      if (to == from + 2 || to == from - 2) {
+        // The rook jumps over the king and can give check.
+        int8_t rook_from = to > from ? from + 3 : from - 4;
+        int8_t rook_to = (from + to)/2;
+        occupied ^= SquareBitboard(rook_from) | SquareBitboard(rook_to);
+        straight =
+          (straight & ~SquareBitboard(rook_from)) | SquareBitboard(rook_to);
+      }
+      break;
+    default:
+      assert(false);  // Invalid piece.
+      break;
   }
-  return false;
+  // Checks by the sliders, including the moved one and discoveries.
+  return
+    (BishopAttacks(king, occupied) & diagonal) ||
+    (RookAttacks(king, occupied) & straight);
 }
 
 Piece Position::GetSquare(Coordinates square) const {
-  return board_[square.file][square.rank];
+  return board_[SquareIndex(square)];
 }
 
 void Position::SetSquare(Coordinates square, Piece piece) {
@@ -213,6 +533,18 @@ void Position::SetSquare(Coordinates square, Piece piece) {
     return;
   }
 
+  if (hash_function_) {
+    UpdateKeys(square, old_piece, piece);
+  }
+  UpdateSquare(square, piece);
+}
+
+void Position::UpdateSquare(Coordinates square, Piece piece) {
+  Piece old_piece = GetSquare(square);
+  if (old_piece == pieces::kNone && piece == pieces::kNone) {
+    return;
+  }
+
   // Straight attacks are not processed right away in UpadateAttacks function
   // Insteaded they are stored to be processed later.
   AttackInfo delayed_attacks = {};
@@ -254,11 +586,9 @@ void Position::SetSquare(Coordinates square, Piece piece) {
       if (piece.player == Player::kWhite) {
         --blocked_for_white;
         ++white_king_factor;
-        white_king_ = square;
       } else if (piece.player == Player::kBlack) {
         --blocked_for_black;
         ++black_king_factor;
-        black_king_ = square;
       } else {
         assert(false);  // Invalid player.
       }
@@ -271,27 +601,119 @@ void Position::SetSquare(Coordinates square, Piece piece) {
   AttackInfo king_attacks = {
     {1, 1}, {1, 1}, {1, 1}, {1, 1}, {1, 1}, {1, 1}, {1, 1}, {1, 1}
   };
-  AttackInfo directed_attacks = directed_attacks_[square.file][square.rank];
-  AttackInfo checking_squares = checking_squares_[square.file][square.rank];
+  AttackInfo directed_attacks = directed_attacks_[SquareIndex(square)];
+  AttackInfo checking_squares = checking_squares_[SquareIndex(square)];
 
   // Include blocking/discoveries when updating straight attacks.
-  directed_attacks.MultiplyPlayerAttacks(Player::kWhite, blocked_for_white);
-  directed_attacks.MultiplyPlayerAttacks(Player::kBlack, blocked_for_black);
+  directed_attacks.MultiplyPlayerAttacks(blocked_for_white, blocked_for_black);
   directed_attacks += delayed_attacks;
 
   // Include checking square information.
-  king_attacks.MultiplyPlayerAttacks(Player::kWhite, white_king_factor);
-  king_attacks.MultiplyPlayerAttacks(Player::kBlack, black_king_factor);
+  king_attacks.MultiplyPlayerAttacks(white_king_factor, black_king_factor);
   checking_squares *= blocked;
   checking_squares += king_attacks;
 
   UpdateStraightAttacks(square, directed_attacks, checking_squares);
 
-  board_[square.file][square.rank] = piece;
+  PlacePiece(square, piece);
+
+}
+
+void Position::PlacePiece(Coordinates square, Piece piece) {
+  Piece old_piece = GetSquare(square);
+  board_[SquareIndex(square)] = piece;
 
-  moves_generated_ = false;
+  Bitboard square_bitboard = SquareBitboard(square);
+  if (old_piece != pieces::kNone) {
+    piece_bitboards_[static_cast<int>(old_piece.type)] &= ~square_bitboard;
+    player_bitboards_[static_cast<int>(old_piece.player)] &= ~square_bitboard;
+  }
+  if (piece != pieces::kNone) {
+    piece_bitboards_[static_cast<int>(piece.type)] |= square_bitboard;
+    player_bitboards_[static_cast<int>(piece.player)] |= square_bitboard;
+  }
+
+  if (piece == pieces::kWhiteKing) {
+    white_king_ = square;
+  } else if (piece == pieces::kBlackKing) {
+    black_king_ = square;
+  }
+}
+
+void Position::RebuildAttacks() {
+  attacks_ = {};
+  attack_totals_ = {};
+  directed_attacks_ = {};
+  checking_squares_ = {};
+
+  Bitboard occupied = GetOccupied();
+  while (occupied) {
+    int8_t index = PopLowestSquare(&occupied);
+    Piece piece = board_[index];
+    Coordinates square = IndexToCoordinates(index);
+    Attacks basic_attacks = piece.player == Player::kWhite ?
+      Attacks{1, 0} :
+      Attacks{0, 1};
+    switch (piece.type) {
+      case (PieceType::kPawn):
+        UpdatePawnAttacks(square, piece.player, basic_attacks);
+        continue;
+      case (PieceType::kKnight):
+        UpdateKnightAttacks(square, basic_attacks);
+        continue;
+      case (PieceType::kKing):
+        UpdateKingAttacks(square, basic_attacks);
+      break;
+      default:
+      break;
+    }
+    for (Coordinates delta : {
+      Coordinates{0, 1}, Coordinates{1, 1}, Coordinates{1, 0},
+      Coordinates{1, -1}, Coordinates{0, -1}, Coordinates{-1, -1},
+      Coordinates{-1, 0}, Coordinates{-1, 1}
+    }) {
+      bool straight = delta.file == 0 || delta.rank == 0;
+      PieceType slider = straight ? PieceType::kRook : PieceType::kBishop;
+      if (piece.type == PieceType::kKing) {
+        RebuildRay(index, delta, {0, 0}, basic_attacks);
+      } else if (piece.type == slider || piece.type == PieceType::kQueen) {
+        RebuildRay(index, delta, basic_attacks, {0, 0});
+      }
+    }
+  }
 }
 
+void Position::RebuildRay(
+  int8_t square,
+  Coordinates delta,
+  Attacks attack,
+  Attacks checking
+) {
+  AttackInfo directed_attack = {};
+  directed_attack.SetByDelta(delta, attack);
+  AttackInfo directed_checking = {};
+  directed_checking.SetByDelta(delta, checking);
+
+  int8_t offset = DirectionOffset(delta);
+  for (int8_t steps = SquaresToEdge(square, delta); steps > 0; --steps) {
+    square += offset;
+    AddAttacks(square, attack);
+    directed_attacks_[square] += directed_attack;
+    checking_squares_[square] += directed_checking;
+    Piece piece = board_[square];
+    if (piece == pieces::kNone) {
+      continue;
+    }
+    // Sliders attack through the opponent's king, same as in
+    // AttackDirection. Kings' checking squares stop at any piece.
+    bool through_king =
+      (attack.by_white && piece == pieces::kBlackKing) ||
+      (attack.by_black && piece == pieces::kWhiteKing);
+    if (!through_king) {
+      break;
+    }
+  }
+}
 
 bool Position::GetCastlingRights(Player player, Castle castle) const {
   if (player == Player::kWhite) {
@@ -312,6 +734,9 @@ bool Position::GetCastlingRights(Player player, Castle castle) const {
 }
 
 void Position::SetCastlingRights(Player player, Castle castle, bool value) {
+  if (hash_function_ && GetCastlingRights(player, castle) != value) {
+    key_ ^= hash_function_->HashCastles(player, castle);
+  }
   if (player == Player::kWhite) {
     if (castle == Castle::kKingside) {
       white_castle_kingside_ = value;
@@ -327,7 +752,20 @@ void Position::SetCastlingRights(Player player, Castle castle, bool value) {
   } else {
     assert(false);  // Invalid player or castling side.
   }
-  moves_generated_ = false;
+}
+
+uint8_t Position::GetCastlingRightsBits() const {
+  return white_castle_kingside_ |
+         white_castle_queenside_ << 1 |
+         black_castle_kingside_ << 2 |
+         black_castle_queenside_ << 3;
+}
+
+void Position::SetCastlingRightsBits(uint8_t bits) {
+  white_castle_kingside_ = bits & 1;
+  white_castle_queenside_ = bits & 2;
+  black_castle_kingside_ = bits & 4;
+  black_castle_queenside_ = bits & 8;
 }
 
   int16_t Position::GetMoveNumber() const {
@@ -343,7 +781,6 @@ void Position::SetCastlingRights(Player player, Castle castle, bool value) {
   }
   void Position::SetHalfmoveClock(int16_t value) {
     halfmove_clock_ = value;
-    moves_generated_ = false;
   }
 
 Coordinates Position::GetEnPessant() const {
@@ -351,8 +788,11 @@ Coordinates Position::GetEnPessant() const {
 }
 
 void Position::SetEnPessant(Coordinates square) {
+  if (hash_function_) {
+    key_ ^= hash_function_->HashEnPessant(en_pessant_);
+    key_ ^= hash_function_->HashEnPessant(square);
+  }
   en_pessant_ = square;
-  moves_generated_ = false;
 }
 
 Coordinates Position::GetKing(Player player) const {
@@ -383,8 +823,7 @@ Position::AttackInfo Position::UpdateAttacks(
   AttackInfo straight_attacks = {};
   switch (piece.type) {
     case (PieceType::kPawn):
-      UpdatePawnAttacks(square, piece.player, 1, basic_attacks);
-      UpdatePawnAttacks(square, piece.player, -1, basic_attacks);
+      UpdatePawnAttacks(square, piece.player, basic_attacks);
     break;
     case (PieceType::kRook):
       straight_attacks.up = basic_attacks;
@@ -422,56 +861,27 @@ Position::AttackInfo Position::UpdateAttacks(
 }
 
 void Position::UpdateKnightAttacks(Coordinates square, Attacks delta) {
-  Piece piece = GetSquare(square);
-  std::array<Coordinates, 8> jumps = {
-    Coordinates{2, 1}, {2, -1}, {-2, 1}, {-2, -1},
-    {1, 2}, {1, -2}, {-1, 2}, {-1, -2}
-  };
-  for (Coordinates jump : jumps) {
-    Coordinates destination = square;
-    destination += jump;
-    if (!WithinTheBoard(destination)) {
-      continue;
-    }
-    attacks_[destination.file][destination.rank] += delta;
-    if (destination == GetKing(Opponent(to_move_))) {
-      check_segment_ = {square, square};
-    }
+  Bitboard destinations = KnightAttacks(SquareIndex(square));
+  while (destinations) {
+    AddAttacks(PopLowestSquare(&destinations), delta);
   }
 }
 
 void Position::UpdateKingAttacks(Coordinates square, Attacks delta) {
-  for (int8_t file = square.file-1; file <= square.file+1; ++file) {
-    for (int8_t rank = square.rank-1; rank <= square.rank+1; ++rank) {
-      if (file == square.file && rank == square.rank) {
-        continue;
-      }
-      Coordinates destination = {file, rank};
-      if (!WithinTheBoard(destination)) {
-        continue;
-      }
-      attacks_[file][rank] += delta;
-    }
+  Bitboard destinations = KingAttacks(SquareIndex(square));
+  while (destinations) {
+    AddAttacks(PopLowestSquare(&destinations), delta);
   }
 }
 
 void Position::UpdatePawnAttacks(
   Coordinates square,
   Player player,
-  int8_t file_delta,
   Attacks delta
 ) {
-  Coordinates destination = square;
-  int8_t dir = PawnDirection(player);
-  destination.rank += dir;
-  destination.file += file_delta;
-  if (!WithinTheBoard(destination)) {
-    return;
-  }
-  attacks_[destination.file][destination.rank] += delta;
-
-  if (destination == GetKing(Opponent(to_move_))) {
-    check_segment_ = {square, square};
+  Bitboard destinations = PawnAttacks(player, SquareIndex(square));
+  while (destinations) {
+    AddAttacks(PopLowestSquare(&destinations), delta);
   }
 }
 
@@ -507,8 +917,14 @@ void Position::UpdateStraightAttacks(
   );
 }
 
+void Position::AddAttacks(int8_t square, Attacks delta) {
+  attacks_[square] += delta;
+  attack_totals_[static_cast<int>(Player::kWhite)] += delta.by_white;
+  attack_totals_[static_cast<int>(Player::kBlack)] += delta.by_black;
+}
+
 Position::Attacks Position::GetAttacks(Coordinates square) const {
-  return attacks_[square.file][square.rank];
+  return attacks_[SquareIndex(square)];
 }
 
 int8_t Position::GetAttacksByPlayer(Coordinates square, Player player) const {
@@ -521,6 +937,19 @@ int8_t Position::GetAttacksByPlayer(Coordinates square, Player player) const {
   return 0;
 }
 
+template<Player player>
+int8_t Position::GetAttacksBy(int8_t square) const {
+  if constexpr (player == Player::kWhite) {
+    return attacks_[square].by_white;
+  } else {
+    return attacks_[square].by_black;
+  }
+}
+
+int16_t Position::GetTotalAttacks(Player player) const {
+  return attack_totals_[static_cast<int>(player)];
+}
+
 int8_t Position::GetChecks(Player player) const {
   if (player == Player::kWhite) {
     return GetAttacks(white_king_).by_black;
@@ -531,321 +960,582 @@ int8_t Position::GetChecks(Player player) const {
   return 0;
 }
 
-void Position::GenerateMoves() const {
+void Position::GenerateMoves(
+  MoveKind kind,
+  bool pseudo_legal,
+  MoveList* out
+) const {
+  if (to_move_ == Player::kWhite) {
+    GenerateMoves<Player::kWhite>(kind, pseudo_legal, out);
+  } else {
+    GenerateMoves<Player::kBlack>(kind, pseudo_legal, out);
+  }
+}
+
+template<Player us>
+void Position::GenerateMoves(
+  MoveKind kind,
+  bool pseudo_legal,
+  MoveList* out
+) const {
   if (halfmove_clock_ == 100) {
     return;
   }
 
-  GenerateCastles();
+  constexpr Player them = Opponent(us);
+  int8_t king = SquareIndex(GetKing(us));
+  if (GetAttacksBy<them>(king)) {
+    GenerateEvasions<us>(kind, out);
+    return;
+  }
 
-  for (int8_t file = 0; file < 8; ++file) {
-    for (int8_t rank = 0; rank < 8; ++rank) {
-      Piece piece = board_[file][rank];
-      if (piece.player != to_move_) {
-        continue;
-      }
+  Bitboard occupied = GetOccupied();
+  Bitboard targets = GetTargets<us>(kind);
+  GenerateKingMoves<us>(king, targets, pseudo_legal, out);
+  if (kind != MoveKind::kCaptures) {
+    GenerateCastles(out);
+  }
 
-      Pins pins = GetPins({file, rank}, to_move_);
-      bool pin =
-        pins.horisontal || pins.vertical || pins.upward || pins.downward;
+  // Pseudo-legal moves of pinned pieces are filtered out by IsLegal.
+  Bitboard pinned = pseudo_legal ? 0 : GetPinned(us);
+  GeneratePawnMoves<us>(kind, ~0ull, pinned, out);
+  if (kind != MoveKind::kQuiets) {
+    GenerateEnPessant<us>(pseudo_legal, out);
+  }
 
-      // Directions the piece can move in.
-      bool vertical_free = !pins.horisontal && !pins.upward && !pins.downward;
-      bool horisontal_free = !pins.vertical && !pins.upward && !pins.downward;
-      bool upward_free = !pins.horisontal && !pins.vertical && !pins.downward;
-      bool downward_free = !pins.horisontal && !pins.vertical && !pins.upward;
+  Bitboard knights = GetPieces(PieceType::kKnight, us) & ~pinned;
+  while (knights) {
+    int8_t from = PopLowestSquare(&knights);
+    PushMoves(from, KnightAttacks(from) & targets, out);
+  }
 
-      int8_t dir = PawnDirection(to_move_);
+  Bitboard queens = GetPieces(PieceType::kQueen, us);
+  Bitboard diagonal = GetPieces(PieceType::kBishop, us) | queens;
+  while (diagonal) {
+    int8_t from = PopLowestSquare(&diagonal);
+    Bitboard destinations = BishopAttacks(from, occupied) & targets;
+    if (pinned & SquareBitboard(from)) {
+      destinations &= Line(king, from);
+    }
+    PushMoves(from, destinations, out);
+  }
 
-      // If we are not in check we should be carefull to not check
-      // our king by moving pinned piece.
+  Bitboard straight = GetPieces(PieceType::kRook, us) | queens;
+  while (straight) {
+    int8_t from = PopLowestSquare(&straight);
+    Bitboard destinations = RookAttacks(from, occupied) & targets;
+    if (pinned & SquareBitboard(from)) {
+      destinations &= Line(king, from);
+    }
+    PushMoves(from, destinations, out);
+  }
+}
 
-      int8_t checks = GetChecks(to_move_);
+template<Player us>
+void Position::GenerateEvasions(MoveKind kind, MoveList* out) const {
+  int8_t king = SquareIndex(GetKing(us));
+  Bitboard targets = GetTargets<us>(kind);
+  GenerateKingMoves<us>(king, targets, false, out);
+  Bitboard checkers = GetCheckers();
+  if (checkers & (checkers - 1)) {
+    return;  // Only the king can deal with a double check.
+  }
 
-      if (checks && pin) {
-        continue;
-      }
-      if (checks >= 2 && piece.type != PieceType::kKing) {
-        continue;
-      }
+  // Capture the checking piece or block the check. Pinned pieces
+  // can't do either, because their lines only cross the check at
+  // the king.
+  Bitboard evasions = checkers | Between(king, LowestSquare(checkers));
+  Bitboard pinned = GetPinned(us);
+  GeneratePawnMoves<us>(kind, evasions, pinned, out);
+  if (kind != MoveKind::kQuiets) {
+    GenerateEnPessant<us>(false, out);
+  }
+  targets &= evasions;
+  Bitboard occupied = GetOccupied();
 
-      switch (piece.type) {
-        case (PieceType::kPawn):
-          if (vertical_free) {
-            GeneratePawnPushes({file, rank});
-          }
-          if (upward_free) {
-            GeneratePawnCaptures({file, rank}, dir);
-          }
-          if (downward_free) {
-            GeneratePawnCaptures({file, rank}, -dir);
-          }
-        break;
-        case (PieceType::kRook):
-          if (vertical_free) {
-            GenerateStraightMoves({file, rank}, {0, 1});
-            GenerateStraightMoves({file, rank}, {0, -1});
-          }
-          if (horisontal_free) {
-            GenerateStraightMoves({file, rank}, {1, 0});
-            GenerateStraightMoves({file, rank}, {-1, 0});
-          }
-        break;
-        case (PieceType::kKnight):
-          if (!pin) {
-            GenerateKnightMoves({file, rank});
-          }
-        break;
-        case (PieceType::kBishop):
-          if (upward_free) {
-            GenerateStraightMoves({file, rank}, {1, 1});
-            GenerateStraightMoves({file, rank}, {-1, -1});
-          }
-          if (downward_free) {
-            GenerateStraightMoves({file, rank}, {1, -1});
-            GenerateStraightMoves({file, rank}, {-1, 1});
-          }
-        break;
-        case (PieceType::kQueen):
-          if (vertical_free) {
-            GenerateStraightMoves({file, rank}, {0, 1});
-            GenerateStraightMoves({file, rank}, {0, -1});
-          }
-          if (horisontal_free) {
-            GenerateStraightMoves({file, rank}, {1, 0});
-            GenerateStraightMoves({file, rank}, {-1, 0});
-          }
-          if (upward_free) {
-            GenerateStraightMoves({file, rank}, {1, 1});
-            GenerateStraightMoves({file, rank}, {-1, -1});
-          }
-          if (downward_free) {
-            GenerateStraightMoves({file, rank}, {1, -1});
-            GenerateStraightMoves({file, rank}, {-1, 1});
-          }
-        break;
-        case (PieceType::kKing):
-          GenerateKingMoves({file, rank});
-        break;
-        default:
-          assert(false);  // Invalid piece.
-        break;
-      }
-    }
+  Bitboard knights = GetPieces(PieceType::kKnight, us) & ~pinned;
+  while (knights) {
+    int8_t from = PopLowestSquare(&knights);
+    PushMoves(from, KnightAttacks(from) & targets, out);
+  }
+
+  Bitboard queens = GetPieces(PieceType::kQueen, us);
+  Bitboard diagonal =
+    (GetPieces(PieceType::kBishop, us) | queens) & ~pinned;
+  while (diagonal) {
+    int8_t from = PopLowestSquare(&diagonal);
+    PushMoves(from, BishopAttacks(from, occupied) & targets, out);
+  }
+
+  Bitboard straight = (GetPieces(PieceType::kRook, us) | queens) & ~pinned;
+  while (straight) {
+    int8_t from = PopLowestSquare(&straight);
+    PushMoves(from, RookAttacks(from, occupied) & targets, out);
   }
 }
 
-void Position::GenerateKnightMoves(Coordinates original_square) const {
-  std::array<Coordinates, 8> jumps = {
-    Coordinates{2, 1}, {2, -1}, {-2, 1}, {-2, -1},
-    {1, 2}, {1, -2}, {-1, 2}, {-1, -2}
-  };
-  for (Coordinates jump : jumps) {
-    Coordinates destination = original_square;
-    destination.file += jump.file;
-    destination.rank += jump.rank;
-    if (!WithinTheBoard(destination)) {
-      continue;
-    }
-    if (GetSquare(destination).player != to_move_) {
-      PushLegalMove({original_square, destination, pieces::kNone});
-    }
+template<Player us>
+Bitboard Position::GetTargets(MoveKind kind) const {
+  if (kind == MoveKind::kCaptures) {
+    return player_bitboards_[static_cast<int>(Opponent(us))];
+  } else if (kind == MoveKind::kQuiets) {
+    return ~GetOccupied();
   }
+  return ~player_bitboards_[static_cast<int>(us)];
 }
 
-void Position::GenerateKingMoves(Coordinates original_square) const {
-  for (
-    int8_t file = original_square.file-1;
-    file <= original_square.file+1;
-    ++file
-  ) {
-    for (
-      int8_t rank = original_square.rank-1;
-      rank <= original_square.rank+1;
-      ++rank
-    ) {
-      if (file == original_square.file && rank == original_square.rank) {
-        continue;
-      }
-      Coordinates destination = {file, rank};
-      if (!WithinTheBoard(destination)) {
-        continue;
-      }
-      if (GetSquare(destination).player != to_move_) {
-        PushLegalMove({original_square, destination, pieces::kNone});
-      }
+template<Player us>
+void Position::GenerateKingMoves(
+  int8_t king,
+  Bitboard targets,
+  bool pseudo_legal,
+  MoveList* out
+) const {
+  Bitboard destinations =
+    KingAttacks(king) & ~player_bitboards_[static_cast<int>(us)] & targets;
+  while (destinations) {
+    int8_t to = PopLowestSquare(&destinations);
+    // Attacks go through the king, so retreating along the line is covered.
+    if (pseudo_legal || !GetAttacksBy<Opponent(us)>(to)) {
+      out->Push(Move(king, to));
     }
   }
-  // TODO(Andrey): Castling.
 }
 
-void Position::GenerateStraightMoves(Coordinates original_square,
-                                     Coordinates delta) const {
-  Piece piece = GetSquare(original_square);
-  Coordinates destination = original_square;
-  destination += delta;
-  while (WithinTheBoard(destination)) {
-    if (GetSquare(destination) != pieces::kNone) {
-      if (GetSquare(destination).player != to_move_) {
-        PushLegalMove({original_square, destination, pieces::kNone});
-      }
-      return;
-    }
-    PushLegalMove({original_square, destination, pieces::kNone});
-    destination += delta;
+template<Player us>
+void Position::GeneratePawnMoves(
+  MoveKind kind,
+  Bitboard targets,
+  Bitboard pinned,
+  MoveList* out
+) const {
+  constexpr int8_t forward = 8*PawnDirection(us);
+  // The rank pawns land on after the first step of a double jump.
+  constexpr Bitboard jump_rank = kRank1 << 8*(DoubleJumpRank(us) + forward/8);
+  constexpr Bitboard promotion_rank = kRank1 << 8*PromotionRank(us);
+  Bitboard pawns = GetPieces(PieceType::kPawn, us);
+  Bitboard empty = ~GetOccupied();
+  Bitboard enemies = player_bitboards_[static_cast<int>(Opponent(us))];
+
+  // Promotions count as captures, double jumps never promote.
+  Bitboard push_targets = targets;
+  if (kind == MoveKind::kCaptures) {
+    push_targets &= promotion_rank;
+  } else if (kind == MoveKind::kQuiets) {
+    push_targets &= ~promotion_rank;
+  }
+  Bitboard single_pushes = Shift(pawns, forward) & empty;
+  Bitboard double_pushes = Shift(single_pushes & jump_rank, forward) & empty;
+  PushPawnMoves(single_pushes & push_targets, forward, pinned, out);
+  PushPawnMoves(double_pushes & push_targets, 2*forward, pinned, out);
+
+  if (kind == MoveKind::kQuiets) {
+    return;
   }
+  // Pawns on the edge files can't capture outside of the board.
+  Bitboard left_captures = Shift(pawns & ~kFileA, forward-1) & enemies;
+  Bitboard right_captures = Shift(pawns & ~kFileH, forward+1) & enemies;
+  PushPawnMoves(left_captures & targets, forward-1, pinned, out);
+  PushPawnMoves(right_captures & targets, forward+1, pinned, out);
 }
 
-void Position::GeneratePawnPushes(Coordinates original_square) const {
-  int8_t dir = PawnDirection(to_move_);
-  Coordinates destination = original_square;
-  destination.rank += dir;
-  if (!WithinTheBoard(destination)) {
-    return;  // 1-square push outside the board -> 2-square push is too.
-  }
-  if (GetSquare(destination) == pieces::kNone) {
-    if (destination.rank != PromotionRank(to_move_)) {
-      PushLegalMove({original_square, destination, pieces::kNone});
-    } else {
-      for (PieceType promote_to : kPromotionOptions) {
-        PushLegalMove({original_square, destination, {promote_to, to_move_}});
-      }
-    }
-    if (original_square.rank == DoubleJumpRank(to_move_)) {
-      destination.rank += dir;
-      if (!WithinTheBoard(destination)) {
-        return;
-      }
-      if (GetSquare(destination) == pieces::kNone) {
-        // Implicitly using the size of the board.
-        PushLegalMove({original_square, destination, pieces::kNone});
-      }
+template<Player us>
+void Position::GenerateEnPessant(bool pseudo_legal, MoveList* out) const {
+  if (en_pessant_ == Coordinates{-1, -1}) {
+    return;
+  }
+  int8_t to = SquareIndex(en_pessant_);
+  Bitboard pawns =
+    PawnAttacks(Opponent(us), to) & GetPieces(PieceType::kPawn, us);
+  while (pawns) {
+    int8_t from = PopLowestSquare(&pawns);
+    if (pseudo_legal || EnPessantIsLegal(from)) {
+      out->Push(Move(from, to));
     }
   }
 }
 
-void Position::GeneratePawnCaptures(
-  Coordinates original_square, int8_t file_delta
-) const {
-  Coordinates destination = original_square;
-  int dir = PawnDirection(to_move_);
-  destination.rank += dir;
-  destination.file += file_delta;
-  if (!WithinTheBoard(destination)) {
-    return;
+bool Position::EnPessantIsLegal(int8_t from) const {
+  int8_t to = SquareIndex(en_pessant_);
+  int8_t taken = to - 8*PawnDirection(to_move_);
+  int8_t king = SquareIndex(GetKing(to_move_));
+  // En pessant removes 2 pawns from 1 rank, and pins are not enough to
+  // tell if it's legal, so just check the position after the capture.
+  Bitboard occupied =
+    (GetOccupied() ^ SquareBitboard(from) ^ SquareBitboard(taken)) |
+    SquareBitboard(to);
+  Bitboard attackers =
+    GetAttackers(king, occupied) &
+    player_bitboards_[static_cast<int>(Opponent(to_move_))] &
+    ~SquareBitboard(taken);
+  return !attackers;
+}
+
+void Position::GenerateCastles(MoveList* out) const {
+  Coordinates king = GetKing(to_move_);
+  if (CastleIsPossible(Castle::kKingside)) {
+    out->Push({king, king + Coordinates{2, 0}, pieces::kNone});
   }
-  if (
-    GetSquare(destination).player != Opponent(to_move_) &&
-    en_pessant_ != destination
-  ) {
-    return;  // Nothing to capture.
+  if (CastleIsPossible(Castle::kQueenside)) {
+    out->Push({king, king + Coordinates{-2, 0}, pieces::kNone});
   }
+}
 
-  // En pessant is annoying, because it removes 2 pawn from 1 rank.
-  if (en_pessant_ == destination) {
-    Piece first_piece = pieces::kNone;
-    Coordinates current = original_square;
-    current.file += file_delta*2;
-    for (; 0 <= current.file && current.file < 8; current.file += file_delta) {
-      if (GetSquare(current) != pieces::kNone) {
-        first_piece = GetSquare(current);
-      }
+bool Position::CastleIsPossible(Castle castle) const {
+  if (!GetCastlingRights(to_move_, castle) || IsCheck()) {
+    return false;
+  }
+  Coordinates delta = castle == Castle::kKingside ?
+    Coordinates{1, 0} :
+    Coordinates{-1, 0};
+  Coordinates current = GetKing(to_move_);
+  for (int8_t i = 0; i < 2; ++i) {
+    current += delta;
+    if (GetAttacksByPlayer(current, Opponent(to_move_))) {
+      return false;
     }
-    Piece second_piece;
-    current = original_square;
-    current.file -= file_delta;
-    for (; 0 <= current.file && current.file < 8; current.file += file_delta) {
-      if (GetSquare(current) != pieces::kNone) {
-        second_piece = GetSquare(current);
-      }
+    if (GetSquare(current) != pieces::kNone) {
+      return false;
     }
-    if (
-      first_piece == Piece{PieceType::kKing, to_move_} &&
-      (
-        second_piece == Piece{PieceType::kKing, Opponent(to_move_)} ||
-        second_piece == Piece{PieceType::kQueen, Opponent(to_move_)}
-      )
-    ) {
-      return;
+  }
+  if (castle == Castle::kQueenside) {
+    // The square next to the rook only has to be empty.
+    current += delta;
+    if (GetSquare(current) != pieces::kNone) {
+      return false;
     }
+  }
+  return true;
+}
+
+void Position::PushMoves(
+  int8_t from,
+  Bitboard destinations,
+  MoveList* out
+) const {
+  while (destinations) {
+    out->Push(Move(from, PopLowestSquare(&destinations)));
+  }
+}
+
+void Position::PushPawnMoves(
+  Bitboard destinations,
+  int8_t offset,
+  Bitboard pinned,
+  MoveList* out
+) const {
+  int8_t king = SquareIndex(GetKing(to_move_));
+  while (destinations) {
+    int8_t to = PopLowestSquare(&destinations);
+    int8_t from = to - offset;
     if (
-      second_piece == Piece{PieceType::kKing, to_move_} &&
-      (
-        first_piece == Piece{PieceType::kKing, Opponent(to_move_)} ||
-        first_piece == Piece{PieceType::kQueen, Opponent(to_move_)}
-      )
+      (pinned & SquareBitboard(from)) &&
+      !(Line(king, from) & SquareBitboard(to))
     ) {
-      return;
+      continue;
+    }
+    if (to >> 3 != PromotionRank(to_move_)) {
+      out->Push(Move(from, to));
+    } else {
+      for (PieceType promote_to : kPromotionOptions) {
+        out->Push(Move(from, to, promote_to));
+      }
     }
   }
-  // All of that was en-pessant.
+}
 
-  if (destination.rank != PromotionRank(to_move_)) {
-    PushLegalMove({
-      original_square, destination, pieces::kNone
-    });
+Bitboard Position::GetOccupied() const {
+  return player_bitboards_[static_cast<int>(Player::kWhite)] |
+         player_bitboards_[static_cast<int>(Player::kBlack)];
+}
+
+Bitboard Position::GetPieces(PieceType type, Player player) const {
+  return piece_bitboards_[static_cast<int>(type)] &
+         player_bitboards_[static_cast<int>(player)];
+}
+
+void Position::SetHashFunction(const ZobristHashFunction* hash_function) {
+  hash_function_ = hash_function;
+  if (hash_function_) {
+    key_ = hash_function_->SlowHash(*this);
+    pawn_key_ = hash_function_->SlowPawnHash(*this);
+    material_key_ = hash_function_->SlowMaterialHash(*this);
   } else {
-    for (PieceType promote_to : kPromotionOptions) {
-      PushLegalMove({original_square, destination, {promote_to, to_move_}});
+    key_ = 0;
+    pawn_key_ = 0;
+    material_key_ = 0;
+  }
+}
+
+uint64_t Position::GetKey() const {
+  return key_;
+}
+
+uint64_t Position::GetKeyAfterMove(Move move) const {
+  assert(hash_function_);  // No hash function to calculate the key.
+  const ZobristHashFunction& hash = *hash_function_;
+  MoveEffects effects = GetMoveEffects(move);
+  uint64_t ret = key_ ^ hash.HashTurn();
+  for (int8_t i = 0; i < effects.size; ++i) {
+    Coordinates square = effects.squares[i];
+    ret ^= hash.HashPiece(square, GetSquare(square));
+    ret ^= hash.HashPiece(square, effects.pieces[i]);
+  }
+  ret ^= hash.HashEnPessant(en_pessant_);
+  ret ^= hash.HashEnPessant(effects.en_pessant);
+  for (int bit = 0; bit < 4; ++bit) {
+    if (effects.lost_castling_rights & 1 << bit) {
+      ret ^= hash.HashCastles(CastlingBitPlayer(bit), CastlingBitSide(bit));
     }
   }
+  return ret;
 }
 
-void Position::GenerateCastles() const {
-  if (IsCheck()) {
-    return;
+uint64_t Position::GetPawnKey() const {
+  return pawn_key_;
+}
+
+uint64_t Position::GetMaterialKey() const {
+  return material_key_;
+}
+
+void Position::UpdateKeys(Coordinates square, Piece old_piece, Piece piece) {
+  const ZobristHashFunction& hash = *hash_function_;
+  key_ ^= hash.HashPiece(square, old_piece);
+  key_ ^= hash.HashPiece(square, piece);
+  if (old_piece.type == PieceType::kPawn) {
+    pawn_key_ ^= hash.HashPiece(square, old_piece);
   }
-  if (GetCastlingRights(to_move_, Castle::kKingside)) {
-    Coordinates king = GetKing(to_move_);
-    Coordinates current = king;
-    bool possible = true;
-    for (int8_t i = 0; i < 2; ++i) {
-      current += {1, 0};
-      if (GetAttacksByPlayer(current, Opponent(to_move_))) {
-        possible = false;
-      }
-      if (GetSquare(current) != pieces::kNone) {
-        possible = false;
-      }
-    }
-    if (possible) {
-      PushLegalMove({king, current, pieces::kNone});
+  if (piece.type == PieceType::kPawn) {
+    pawn_key_ ^= hash.HashPiece(square, piece);
+  }
+  // Bitboards still hold the old piece.
+  if (old_piece != pieces::kNone) {
+    int8_t count = CountSquares(GetPieces(old_piece.type, old_piece.player));
+    material_key_ ^= hash.HashMaterial(old_piece, count - 1);
+  }
+  if (piece != pieces::kNone) {
+    int8_t count = CountSquares(GetPieces(piece.type, piece.player));
+    if (old_piece == piece) {
+      --count;
     }
+    material_key_ ^= hash.HashMaterial(piece, count);
   }
-  if (GetCastlingRights(to_move_, Castle::kQueenside)) {
-    Coordinates king = GetKing(to_move_);
-    Coordinates current = king;
-    bool possible = true;
-    for (int8_t i = 0; i < 2; ++i) {
-      current += {-1, 0};
-      if (GetAttacksByPlayer(current, Opponent(to_move_))) {
-        possible = false;
-      }
-      if (GetSquare(current) != pieces::kNone) {
-        possible = false;
-      }
+}
+
+int32_t Position::StaticExchange(Move move) const {
+  int8_t to = move.GetToIndex();
+  Bitboard occupied = GetOccupied();
+  // Balance of the exchange after every capture, from the point of
+  // view of the player making that capture.
+  std::array<int32_t, 32> gain;
+  gain[0] = GetExchangeGain(move, &occupied);
+  PieceType on_square = move.GetPromotion() != PieceType::kNone ?
+    move.GetPromotion() :
+    board_[move.GetFromIndex()].type;
+  Bitboard attackers = GetAttackers(to, occupied) & occupied;
+  Player player = Opponent(to_move_);
+  int depth = 0;
+  while (true) {
+    Bitboard own = player_bitboards_[static_cast<int>(player)];
+    Bitboard opponents = player_bitboards_[static_cast<int>(Opponent(player))];
+    int8_t from;
+    PieceType attacker = GetLeastValuableAttacker(attackers & own, &from);
+    if (attacker == PieceType::kNone) {
+      break;
+    }
+    if (attacker == PieceType::kKing && (attackers & opponents)) {
+      break;  // The king can't take a defended piece.
+    }
+    ++depth;
+    gain[depth] = ExchangeValue(on_square) - gain[depth-1];
+    on_square = attacker;
+    occupied ^= SquareBitboard(from);
+    attackers = (attackers | GetSliderAttackers(to, occupied)) & occupied;
+    player = Opponent(player);
+  }
+  // Either side can stop capturing, if it only loses material.
+  for (; depth > 0; --depth) {
+    gain[depth-1] = std::min(gain[depth-1], -gain[depth]);
+  }
+  return gain[0];
+}
+
+bool Position::SeeGE(Move move, int32_t threshold) const {
+  int8_t to = move.GetToIndex();
+  Bitboard occupied = GetOccupied();
+  // How much the player to move is above the threshold, if the
+  // opponent stops capturing.
+  int32_t swap = GetExchangeGain(move, &occupied) - threshold;
+  if (swap < 0) {
+    return false;
+  }
+  PieceType on_square = move.GetPromotion() != PieceType::kNone ?
+    move.GetPromotion() :
+    board_[move.GetFromIndex()].type;
+  // Now how much the opponent is above it, if it recaptures for free.
+  swap = ExchangeValue(on_square) - swap;
+  if (swap <= 0) {
+    return true;
+  }
+
+  Bitboard attackers = GetAttackers(to, occupied) & occupied;
+  Player player = to_move_;
+  // Whether the result is reached, if the exchange stops here.
+  bool result = true;
+  while (true) {
+    player = Opponent(player);
+    Bitboard own = player_bitboards_[static_cast<int>(player)];
+    Bitboard opponents = player_bitboards_[static_cast<int>(Opponent(player))];
+    int8_t from;
+    PieceType attacker = GetLeastValuableAttacker(attackers & own, &from);
+    if (attacker == PieceType::kNone) {
+      break;
     }
-    Coordinates extra = current;
-    extra += {-1, 0};
-    if (GetSquare(extra) != pieces::kNone) {
-      possible = false;
+    result = !result;
+    if (attacker == PieceType::kKing) {
+      // The king can only take, if nothing takes it back.
+      return (attackers & opponents) ? !result : result;
     }
-    if (possible) {
-      PushLegalMove({king, current, pieces::kNone});
+    swap = ExchangeValue(attacker) - swap;
+    if (swap < static_cast<int32_t>(result)) {
+      break;
     }
+    occupied ^= SquareBitboard(from);
+    attackers = (attackers | GetSliderAttackers(to, occupied)) & occupied;
   }
+  return result;
+}
+
+int32_t Position::GetExchangeGain(Move move, Bitboard* occupied) const {
+  int8_t from = move.GetFromIndex();
+  int8_t to = move.GetToIndex();
+  Piece piece = board_[from];
+  int32_t gain = ExchangeValue(board_[to].type);
+  *occupied ^= SquareBitboard(from);
+  if (piece.type == PieceType::kPawn && move.GetTo() == en_pessant_) {
+    gain = ExchangeValue(PieceType::kPawn);
+    *occupied ^= SquareBitboard(to - 8*PawnDirection(piece.player));
+  }
+  if (move.GetPromotion() != PieceType::kNone) {
+    gain +=
+      ExchangeValue(move.GetPromotion()) - ExchangeValue(PieceType::kPawn);
+  }
+  return gain;
+}
+
+PieceType Position::GetLeastValuableAttacker(
+  Bitboard attackers,
+  int8_t* square
+) const {
+  for (PieceType type : kCheapestFirst) {
+    Bitboard pieces =
+      attackers & piece_bitboards_[static_cast<int>(type)];
+    if (pieces) {
+      *square = LowestSquare(pieces);
+      return type;
+    }
+  }
+  return PieceType::kNone;
+}
+
+Bitboard Position::GetSliderAttackers(int8_t square, Bitboard occupied) const {
+  Bitboard queens = piece_bitboards_[static_cast<int>(PieceType::kQueen)];
+  Bitboard diagonal =
+    piece_bitboards_[static_cast<int>(PieceType::kBishop)] | queens;
+  Bitboard straight =
+    piece_bitboards_[static_cast<int>(PieceType::kRook)] | queens;
+  return
+    (BishopAttacks(square, occupied) & diagonal) |
+    (RookAttacks(square, occupied) & straight);
+}
+
+Bitboard Position::GetAttackers(int8_t square, Bitboard occupied) const {
+  Bitboard queens = piece_bitboards_[static_cast<int>(PieceType::kQueen)];
+  Bitboard diagonal =
+    piece_bitboards_[static_cast<int>(PieceType::kBishop)] | queens;
+  Bitboard straight =
+    piece_bitboards_[static_cast<int>(PieceType::kRook)] | queens;
+  return
+    (PawnAttacks(Player::kBlack, square) &
+      GetPieces(PieceType::kPawn, Player::kWhite)) |
+    (PawnAttacks(Player::kWhite, square) &
+      GetPieces(PieceType::kPawn, Player::kBlack)) |
+    (KnightAttacks(square) &
+      piece_bitboards_[static_cast<int>(PieceType::kKnight)]) |
+    (KingAttacks(square) &
+      piece_bitboards_[static_cast<int>(PieceType::kKing)]) |
+    (BishopAttacks(square, occupied) & diagonal) |
+    (RookAttacks(square, occupied) & straight);
+}
+
+Bitboard Position::GetCheckers() const {
+  return
+    GetAttackers(SquareIndex(GetKing(to_move_)), GetOccupied()) &
+    player_bitboards_[static_cast<int>(Opponent(to_move_))];
+}
+
+Bitboard Position::GetPinned(Player player) const {
+  int8_t king = SquareIndex(GetKing(player));
+  Player opponent = Opponent(player);
+  Bitboard queens = GetPieces(PieceType::kQueen, opponent);
+  // Opponent's sliders, that would attack the king on an empty board.
+  Bitboard snipers =
+    (BishopAttacks(king, 0) &
+      (GetPieces(PieceType::kBishop, opponent) | queens)) |
+    (RookAttacks(king, 0) &
+      (GetPieces(PieceType::kRook, opponent) | queens));
+  Bitboard occupied = GetOccupied();
+  Bitboard ret = 0;
+  while (snipers) {
+    Bitboard blockers = Between(king, PopLowestSquare(&snipers)) & occupied;
+    if (CountSquares(blockers) == 1) {
+      ret |= blockers & player_bitboards_[static_cast<int>(player)];
+    }
+  }
+  return ret;
 }
 
 std::vector<Move> Position::GetCapturesOnSquare(
   Coordinates square, Player player
 ) const {
-  std::vector<Move> out;
+  MoveList moves;
+  GetCapturesOnSquare(square, player, &moves);
+  std::vector<Move> ret;
+  ret.reserve(moves.Size());
+  for (const MoveList::Entry& entry : moves) {
+    ret.push_back(entry.move);
+  }
+  return ret;
+}
+
+void Position::GetCapturesOnSquare(
+  Coordinates square, Player player, MoveList* out
+) const {
+  out->Clear();
+  if (square == en_pessant_) {
+    // En pessant is the only capture on an empty square.
+    if (player == Player::kWhite && to_move_ == Player::kWhite) {
+      GenerateEnPessant<Player::kWhite>(false, out);
+    } else if (player == Player::kBlack && to_move_ == Player::kBlack) {
+      GenerateEnPessant<Player::kBlack>(false, out);
+    }
+    return;
+  }
   GenerateKingMovesOnSquare(square, player, out);
-  if (
-    (GetChecks(player) == 1 && !BelongsToSegment(check_segment_, square)) ||
-    GetChecks(player) > 1
-  ) {
-    return out;
+  int8_t checks = GetChecks(player);
+  if (checks > 1) {
+    return;
+  }
+  if (checks == 1) {
+    // Only the checking piece can be captured.
+    int8_t king = SquareIndex(GetKing(player));
+    Bitboard checkers =
+      GetAttackers(king, GetOccupied()) &
+      player_bitboards_[static_cast<int>(Opponent(player))];
+    if (!(checkers & SquareBitboard(square))) {
+      return;
+    }
   }
   GeneratePawnCapturesOnSquare(square, player, out);
   GenerateKnightMovesOnSquare(square, player, out);
@@ -875,75 +1565,65 @@ std::vector<Move> Position::GetCapturesOnSquare(
   GenerateStraightCapturesOnSqaure(
     square, {-1, 1}, player, PieceType::kBishop, out
   );
-
-  return out;
 }
 
 void Position::GenerateKnightMovesOnSquare(
   Coordinates square,
   Player player,
-  std::vector<Move>& out
+  MoveList* out
 ) const {
-    std::array<Coordinates, 8> jumps = {
-    Coordinates{2, 1}, {2, -1}, {-2, 1}, {-2, -1},
-    {1, 2}, {1, -2}, {-1, 2}, {-1, -2}
-  };
-  for (Coordinates jump : jumps) {
-    Coordinates origin = square;
-    origin += jump;
-    if (
-      !WithinTheBoard(origin) ||
-      GetSquare(origin) != Piece{PieceType::kKnight, player}
-    ) {
-      continue;
-    }
-    Pins pins = GetPins(square, player);
+  Bitboard origins =
+    KnightAttacks(SquareIndex(square)) & GetPieces(PieceType::kKnight, player);
+  while (origins) {
+    Coordinates origin = IndexToCoordinates(PopLowestSquare(&origins));
+    Pins pins = GetPins(origin, player);
     if (pins.vertical || pins.upward || pins.horisontal || pins.downward) {
       continue;
     }
+    out->Push({origin, square, pieces::kNone});
   }
 }
 
 void Position::GenerateKingMovesOnSquare(
   Coordinates square,
   Player player,
-  std::vector<Move>& out
+  MoveList* out
 ) const {
   if (GetAttacksByPlayer(square, Opponent(player))) {
     return;
   }
-  if (DistanceSquared(GetKing(player), square) > 2) {
+  if (Distance(SquareIndex(GetKing(player)), SquareIndex(square)) > 1) {
     return;
   }
-  out.push_back({GetKing(player), square, pieces::kNone});
+  out->Push({GetKing(player), square, pieces::kNone});
 }
 
 void Position::GeneratePawnCapturesOnSquare(
     Coordinates square,
     Player player,
-    std::vector<Move>& out
+    MoveList* out
 ) const {
-  if (square == en_pessant_) {
-    return;  // TODO(Andrey): Deal with en pessant.
-  }
-  int8_t dir = PawnDirection(player);
-  Coordinates first_delta = {
-    static_cast<int8_t>(-dir), static_cast<int8_t>(-dir)
-  };
-  Coordinates second_delta = {
-    static_cast<int8_t>(dir), static_cast<int8_t>(-dir)
-  };
-  for (Coordinates delta : {first_delta, second_delta}) {
-    Coordinates origin = square + delta;
-    if (
-      !WithinTheBoard(origin) ||
-      GetSquare(origin) != Piece{PieceType::kPawn, player}
-    ) {
+  // Pawns capture onto the square from where the opponent's pawn
+  // would capture.
+  Bitboard origins =
+    PawnAttacks(Opponent(player), SquareIndex(square)) &
+    GetPieces(PieceType::kPawn, player);
+  while (origins) {
+    Coordinates origin = IndexToCoordinates(PopLowestSquare(&origins));
+    Coordinates delta = {
+      static_cast<int8_t>(origin.file - square.file),
+      static_cast<int8_t>(origin.rank - square.rank)
+    };
+    Pins pins = GetPins(origin, player);
+    if (!FreeInDirection(pins, delta)) {
       continue;
     }
-    Pins pins = GetPins(origin, player);
-    if (FreeInDirection(pins, delta)) {
-      out.push_back({origin, square, pieces::kNone});
+    if (square.rank != PromotionRank(player)) {
+      out->Push({origin, square, pieces::kNone});
+    } else {
+      for (PieceType promote_to : kPromotionOptions) {
+        out->Push({origin, square, {promote_to, player}});
+      }
     }
   }
 }
@@ -953,22 +1633,26 @@ void Position::GenerateStraightCapturesOnSqaure(
   Coordinates delta,
   Player player,
   PieceType attacker,
-  std::vector<Move>& out
+  MoveList* out
 ) const {
-  Coordinates current = square + delta;
-  while (WithinTheBoard(current) && GetSquare(current) == pieces::kNone) {
-    current += delta;
-  }
-  if (!WithinTheBoard(current)) {
+  int8_t current = SquareIndex(square);
+  int8_t offset = DirectionOffset(delta);
+  for (int8_t steps = SquaresToEdge(current, delta); steps > 0; --steps) {
+    current += offset;
+    Piece piece = board_[current];
+    if (piece == pieces::kNone) {
+      continue;
+    }
+    Coordinates origin = IndexToCoordinates(current);
+    if (
+      (piece.type == attacker || piece.type == PieceType::kQueen) &&
+      piece.player == player &&
+      FreeInDirection(GetPins(origin, player), delta)
+    ) {
+      out->Push({origin, square, pieces::kNone});
+    }
     return;
   }
-  Piece piece = GetSquare(current);
-  if (
-    (piece.type == attacker || piece.type == PieceType::kQueen) &&
-    piece.player == player
-  ) {
-    out.push_back({current, square, pieces::kNone});
-  }
 }
 
 void Position::AttackDirection(
@@ -977,18 +1661,26 @@ void Position::AttackDirection(
   Attacks attack_delta,
   Attacks checking_square_delta
 ) {
+  // Most directions don't change at all.
+  if (
+    attack_delta == Attacks{0, 0} &&
+    checking_square_delta == Attacks{0, 0}
+  ) {
+    return;
+  }
   AttackInfo directed_delta = {};
   directed_delta.SetByDelta(delta, attack_delta);
   AttackInfo directed_king_delta = {};
   directed_king_delta.SetByDelta(delta, checking_square_delta);
 
-  Coordinates current = square;
-  current += delta;
-  while (WithinTheBoard(current)) {
-    attacks_[current.file][current.rank] += attack_delta;
-    directed_attacks_[current.file][current.rank] += directed_delta;
-    checking_squares_[current.file][current.rank] += directed_king_delta;
-    Piece current_piece = GetSquare(current);
+  int8_t current = SquareIndex(square);
+  int8_t offset = DirectionOffset(delta);
+  for (int8_t steps = SquaresToEdge(current, delta); steps > 0; --steps) {
+    current += offset;
+    AddAttacks(current, attack_delta);
+    directed_attacks_[current] += directed_delta;
+    checking_squares_[current] += directed_king_delta;
+    Piece current_piece = board_[current];
     if (current_piece != pieces::kNone) {
       if (current_piece != pieces::kBlackKing) {
         attack_delta.by_white = 0;
@@ -999,57 +1691,18 @@ void Position::AttackDirection(
         directed_delta.MultiplyPlayerAttacks(Player::kBlack, 0);
       }
       directed_king_delta = {};  // Set all members to 0.
+      // Nothing goes past the blocker, unless it's a king.
+      if (attack_delta == Attacks{0, 0}) {
+        break;
+      }
     }
-    current += delta;
-  }
-}
-
-void Position::UpdateCheckSegment() {
-  int8_t checks = GetChecks(to_move_);
-  if (checks != 1) {
-    return;  // No checks - no need to worry, double check - run.
   }
-  Coordinates king = GetKing(to_move_);
-  Coordinates current = king;
-  Coordinates delta;
-  AttackInfo attacks_on_king = directed_attacks_[current.file][current.rank];
-  // Member pointer to a member, indicating opponnts atacks.
-  int8_t Attacks::*by_opponent = (
-    to_move_ == Player::kWhite ? &Attacks::by_black : &Attacks::by_white
-  );
-
-  if (attacks_on_king.up.*by_opponent > 0) {
-    delta = {0, -1};
-  } else if (attacks_on_king.up_right.*by_opponent > 0) {
-    delta = {-1, -1};
-  } else if (attacks_on_king.right.*by_opponent > 0) {
-    delta = {-1, 0};
-  } else if (attacks_on_king.down_right.*by_opponent > 0) {
-    delta = {-1, 1};
-  } else if (attacks_on_king.down.*by_opponent > 0) {
-    delta = {0, 1};
-  } else if (attacks_on_king.down_left.*by_opponent > 0) {
-    delta = {1, 1};
-  } else if (attacks_on_king.left.*by_opponent > 0) {
-    delta = {1, 0};
-  } else if (attacks_on_king.up_left.*by_opponent > 0) {
-    delta = {1, -1};
-  } else {
-    return;  // Must've been checked by a knight or a pawn.
-  }
-  current += delta;
-  Piece current_piece = GetSquare(current);
-  while (current_piece == pieces::kNone) {
-    current += delta;
-    current_piece = GetSquare(current);
-  }
-  check_segment_ = {king, current};
 }
 
 Position::Pins Position::GetPins(Coordinates square, Player player) const {
   Pins ret;
-  AttackInfo attacks = directed_attacks_[square.file][square.rank];
-  AttackInfo king_attacks = checking_squares_[square.file][square.rank];
+  AttackInfo attacks = directed_attacks_[SquareIndex(square)];
+  AttackInfo king_attacks = checking_squares_[SquareIndex(square)];
 
   // Member pointers to avoid ifs and code duplication.
   int8_t Attacks::*by_player = (
@@ -1087,7 +1740,7 @@ bool Position::FreeInDirection(Pins pins, Coordinates delta) {
     return !pins.upward && !pins.horisontal && !pins.downward;
   } else if (delta == Coordinates{1, 1} || delta == Coordinates{-1, -1}) {
     return !pins.vertical && !pins.horisontal && !pins.downward;
-  } else if (delta == Coordinates{1, 0} || delta == Coordinates{0, 1}) {
+  } else if (delta == Coordinates{1, 0} || delta == Coordinates{-1, 0}) {
     return !pins.vertical && !pins.upward && !pins.downward;
   } else if (delta == Coordinates{1, -1} || delta == Coordinates{-1, 1}) {
     return !pins.vertical && !pins.upward && !pins.horisontal;
@@ -1096,27 +1749,6 @@ bool Position::FreeInDirection(Pins pins, Coordinates delta) {
   return true;
 }
 
-void Position::PushLegalMove(Move move) const {
-  Piece old_piece = GetSquare(move.from);
-  if (old_piece.type == PieceType::kKing) {
-    if (old_piece.player == Player::kWhite) {
-      if (!GetAttacks(move.to).by_black) {
-        legal_moves_.push_back(move);
-      }
-    } else if (old_piece.player == Player::kBlack) {
-      if (!GetAttacks(move.to).by_white) {
-        legal_moves_.push_back(move);
-      }
-    } else {
-      assert(false);  // Ivalid player.
-    }
-  } else {
-    if (!GetChecks(to_move_) || BelongsToSegment(check_segment_, move.to)) {
-      legal_moves_.push_back(move);
-    }
-  }
-}
-
 Position::Attacks& Position::Attacks::operator+=(Attacks other) {
   by_white += other.by_white;
   by_black += other.by_black;
@@ -1162,20 +1794,39 @@ void Position::AttackInfo::SetByDelta(Coordinates delta, Attacks value) {
 }
 
 void Position::AttackInfo::MultiplyPlayerAttacks(Player player, int8_t factor) {
-  // Memeber pointer to avoid ifs and code duplication.
-  int8_t Attacks::*by_player =
-    player == Player::kWhite ? &Attacks::by_white : &Attacks::by_black;
-  up.*by_player *= factor;
-  up_right.*by_player *= factor;
-  right.*by_player *= factor;
-  down_right.*by_player *= factor;
-  down.*by_player *= factor;
-  down_left.*by_player *= factor;
-  left.*by_player *= factor;
-  up_left.*by_player *= factor;
+  if (player == Player::kWhite) {
+    MultiplyPlayerAttacks(factor, 1);
+  } else if (player == Player::kBlack) {
+    MultiplyPlayerAttacks(1, factor);
+  } else {
+    assert(false);  // Invalid player.
+  }
+}
+
+void Position::AttackInfo::MultiplyPlayerAttacks(
+  int8_t white_factor,
+  int8_t black_factor
+) {
+#ifdef CHESS_ENGINE_VECTOR_ATTACKS
+  AttackInfo factors;
+  factors.up = factors.up_right = factors.right = factors.down_right =
+    factors.down = factors.down_left = factors.left = factors.up_left =
+    {white_factor, black_factor};
+  StoreVector(this, MultiplyVectors(LoadVector(this), LoadVector(&factors)));
+#else
+  for (Attacks* attacks : {
+    &up, &up_right, &right, &down_right, &down, &down_left, &left, &up_left
+  }) {
+    attacks->by_white *= white_factor;
+    attacks->by_black *= black_factor;
+  }
+#endif
 }
 
 Position::AttackInfo& Position::AttackInfo::operator+=(AttackInfo other) {
+#ifdef CHESS_ENGINE_VECTOR_ATTACKS
+  StoreVector(this, AddVectors(LoadVector(this), LoadVector(&other)));
+#else
   up += other.up;
   up_right += other.up_right;
   right += other.right;
@@ -1184,25 +1835,25 @@ Position::AttackInfo& Position::AttackInfo::operator+=(AttackInfo other) {
   down_left += other.down_left;
   left += other.left;
   up_left += other.up_left;
+#endif
   return *this;
 }
 
 Position::AttackInfo& Position::AttackInfo::operator*=(int8_t other) {
-  up *= other;
-  up_right *= other;
-  right *= other;
-  down_right *= other;
-  down *= other;
-  down_left *= other;
-  left *= other;
-  up_left *= other;
+  MultiplyPlayerAttacks(other, other);
   return *this;
 }
 
 Position::AttackInfo Position::AttackInfo::operator-() {
+#ifdef CHESS_ENGINE_VECTOR_ATTACKS
+  AttackInfo ret;
+  StoreVector(&ret, NegateVector(LoadVector(this)));
+  return ret;
+#else
   return {
     -up, -up_right, -right, -down_right, -down, -down_left, -left, -up_left
   };
+#endif
 }
 
 }  // namespace chess_engine
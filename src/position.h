@@ -5,10 +5,14 @@
 #include <cstdint>
 #include <vector>
 
+#include "src/bitboard.h"
 #include "src/chess_defines.h"
+#include "src/move_list.h"
 
 namespace chess_engine {
 
+class ZobristHashFunction;
+
 // One of the central classes.
 // Responsible for keeping track of the board state,
 // generating legal moves, checking for checkmate or stalemate.
@@ -17,6 +21,8 @@ class Position {
   bool IsCheck() const;
   bool IsCheckmate() const;
   bool IsStalemate() const;
+  // Neither player has enough pieces to checkmate.
+  bool IsInsufficientMaterial() const;
 
   // Whose turn it is.
   Player PlayerToMove() const;
@@ -24,17 +30,51 @@ class Position {
   void PassTheTurn();
 
   std::vector<Move> GetLegalMoves() const;
+  // Same, but without allocations. 'out' is cleared first.
+  void GetLegalMoves(MoveList* out) const;
   std::vector<Move> GetCapturesOnSquare(
     Coordinates square, Player player
   ) const;
+  void GetCapturesOnSquare(
+    Coordinates square, Player player, MoveList* out
+  ) const;
 
+  // Legal captures, including en pessant, and all promotions.
+  // Appended to 'out', so stages of the search can share a list.
+  void GenerateCaptures(MoveList* out) const;
+  // The rest of the legal moves. Appended to 'out'.
+  void GenerateQuiets(MoveList* out) const;
+  // Same, but moves may leave the king in check. Legality work is left
+  // for IsLegal, so it's skipped for moves the search never gets to.
+  // In check only legal moves are generated.
+  void GeneratePseudoLegalCaptures(MoveList* out) const;
+  void GeneratePseudoLegalQuiets(MoveList* out) const;
+  // Whether a pseudo-legal move leaves the king safe.
+  bool IsLegal(Move move) const;
+
+  // Works for any move, even one from a different position, so moves
+  // can be tried before generating anything.
   bool MoveIsLegal(Move move) const;
-  // If function returns true then move is definitely a check.
-  // If checking move is castling or a capture might return false.
-  bool MoveIsCheckFast(Move move) const;
-
-  // Makes a move, without leglity checks.
-  void MakeMove(Move move);
+  // Whether the move checks the opponent's king, including discovered
+  // checks, en pessant, castling and promotions.
+  bool GivesCheck(Move move) const;
+
+  // Static exchange evaluation: material won by the player to move,
+  // if both players keep capturing on the destination of the move,
+  // least valuable pieces first, and stop, when it stops paying off.
+  // Sliders behind the capturing pieces join in. Pins are ignored.
+  int32_t StaticExchange(Move move) const;
+  // Same as StaticExchange(move) >= threshold, but stops early.
+  bool SeeGE(Move move, int32_t threshold) const;
+
+  struct UndoInfo;
+
+  // Makes a move, without leglity checks. Passing kNullMove just passes
+  // the turn. If 'undo' is provided, it's filled, so the move can be
+  // taken back.
+  void MakeMove(Move move, UndoInfo* undo = nullptr);
+  // Takes back a move, made with MakeMove.
+  void UnmakeMove(const UndoInfo& undo);
 
   Piece GetSquare(int file, int rank) const;
   Piece GetSquare(Coordinates square) const;
@@ -58,8 +98,54 @@ class Position {
   // The amount of checks player is in (only 0, 1 or 2 are possible).
   int8_t GetChecks(Player player) const;
   int8_t GetAttacksByPlayer(Coordinates square, Player player) const;
+  // Sum of the player's attacks over all squares.
+  int16_t GetTotalAttacks(Player player) const;
+
+  // Sets of squares, so callers only visit occupied squares.
+  Bitboard GetOccupied() const;
+  Bitboard GetPieces(PieceType type, Player player) const;
+
+  // The Zobrist key is updated along with the position, once a hash
+  // function is set. Setting it calculates the key from scratch.
+  // The function must outlive the position.
+  void SetHashFunction(const ZobristHashFunction* hash_function);
+  uint64_t GetKey() const;
+  // Key of the position after the move, without making it. Only the
+  // keys are touched, so it's cheap enough to probe tables with.
+  // Only works when there is a hash function.
+  uint64_t GetKeyAfterMove(Move move) const;
+  // Keys of the pawn structure and of the number of pieces of each kind.
+  // Updated the same way as the main key.
+  uint64_t GetPawnKey() const;
+  uint64_t GetMaterialKey() const;
 
  private:
+  // Fills the fields directly, when it restores a position.
+  friend class PositionSnapshot;
+
+  uint8_t GetCastlingRightsBits() const;
+  void SetCastlingRightsBits(uint8_t bits);
+
+  // What a move changes, apart from the turn. MakeMove applies it,
+  // GetKeyAfterMove only hashes it, so the two can't disagree.
+  struct MoveEffects {
+    // Squares in the order they are set, with what ends up on them.
+    // Castles change four squares, en pessant three, the rest two.
+    std::array<Coordinates, 4> squares;
+    std::array<Piece, 4> pieces;
+    int8_t size = 0;
+    Coordinates en_pessant = {-1, -1};
+    // Castling rights bits, that the move takes away.
+    uint8_t lost_castling_rights = 0;
+    bool resets_halfmove_clock = false;
+
+    void Add(Coordinates square, Piece piece);
+  };
+  MoveEffects GetMoveEffects(Move move) const;
+  // Player and side of a castling rights bit.
+  static Player CastlingBitPlayer(int bit);
+  static Castle CastlingBitSide(int bit);
+
   struct Pins {
     int8_t horisontal = 0;
     int8_t vertical = 0;
@@ -71,40 +157,97 @@ class Position {
   void SetPin(Coordinates square, Player player, Coordinates delta, bool value);
   static bool FreeInDirection(Pins pins, Coordinates delta);
 
-  void GenerateMoves() const;
-  void GeneratePawnMoves(Coordinates original_square) const;
-  void GenerateKnightMoves(Coordinates original_square) const;
-  void GenerateKingMoves(Coordinates original_square) const;
+  bool HasLegalMoves() const;
+  // Whether the move can be made, if we ignore the safety of the king.
+  bool MoveIsPseudoLegal(Move move) const;
+
+  // Templates below are instantiated for the player to move, so color
+  // checks are resolved at compile time. Public functions dispatch
+  // to them once.
+  template<Player us>
+  bool IsLegal(Move move) const;
+  template<Player us>
+  bool GivesCheck(Move move) const;
+
+  enum struct MoveKind {
+    kCaptures = 0,  // Including promotions.
+    kQuiets = 1,
+    kAll = 2
+  };
 
-  void GenerateStraightMoves(
-    Coordinates original_square, Coordinates delta
+  void GenerateMoves(MoveKind kind, bool pseudo_legal, MoveList* out) const;
+  template<Player us>
+  void GenerateMoves(MoveKind kind, bool pseudo_legal, MoveList* out) const;
+  // Only king moves, captures of the checker and blocks, always legal.
+  template<Player us>
+  void GenerateEvasions(MoveKind kind, MoveList* out) const;
+  // Squares, where pieces of the player can go, for the 'kind' of moves.
+  template<Player us>
+  Bitboard GetTargets(MoveKind kind) const;
+  template<Player us>
+  void GenerateKingMoves(
+    int8_t king,
+    Bitboard targets,
+    bool pseudo_legal,
+    MoveList* out
   ) const;
-
-  void GeneratePawnPushes(Coordinates original_square) const;
-
-  void GeneratePawnCaptures(
-    Coordinates original_square, int8_t file_delta
+  template<Player us>
+  void GeneratePawnMoves(
+    MoveKind kind,
+    Bitboard targets,
+    Bitboard pinned,
+    MoveList* out
+  ) const;
+  template<Player us>
+  void GenerateEnPessant(bool pseudo_legal, MoveList* out) const;
+  void GenerateCastles(MoveList* out) const;
+  // Castles are always checked for legality right away.
+  bool CastleIsPossible(Castle castle) const;
+
+  // Pushes moves from 'from' to every square in 'destinations'.
+  void PushMoves(int8_t from, Bitboard destinations, MoveList* out) const;
+  // Pushes pawn moves to 'destinations', made by pawns 'offset' squares
+  // behind them. Pinned pawns can't leave the line with their king.
+  void PushPawnMoves(
+    Bitboard destinations,
+    int8_t offset,
+    Bitboard pinned,
+    MoveList* out
   ) const;
 
-  void GenerateCastles() const;
+  // Value of the piece taken by the move, plus the promotion. Removes
+  // the moving piece and pawns taken en pessant from 'occupied'.
+  int32_t GetExchangeGain(Move move, Bitboard* occupied) const;
+  // Returns the cheapest type among 'attackers' and puts one of
+  // them to 'square'. kNone, if there are no attackers.
+  PieceType GetLeastValuableAttacker(Bitboard attackers, int8_t* square) const;
+  // Bishops, rooks and queens of both players, attacking a square.
+  Bitboard GetSliderAttackers(int8_t square, Bitboard occupied) const;
+  // Pieces of both players, attacking a square, if board was 'occupied'.
+  Bitboard GetAttackers(int8_t square, Bitboard occupied) const;
+  // Pieces of the 'player' that can't leave the line with their king.
+  Bitboard GetPinned(Player player) const;
+  // Opponent's pieces, giving check to the player to move.
+  Bitboard GetCheckers() const;
+  // Whether en pessant from 'from' leaves the king safe.
+  bool EnPessantIsLegal(int8_t from) const;
 
   void GenerateKnightMovesOnSquare(
     Coordinates square,
     Player player,
-    std::vector<Move>& out
+    MoveList* out
   ) const;
 
   void GenerateKingMovesOnSquare(
     Coordinates square,
     Player player,
-    std::vector<Move>& out
+    MoveList* out
   ) const;
 
-  // This will only promote to queen, because it's used in a quiescence search.
   void GeneratePawnCapturesOnSquare(
     Coordinates square,
     Player player,
-    std::vector<Move>& out
+    MoveList* out
   ) const;
 
   void GenerateStraightCapturesOnSqaure(
@@ -112,7 +255,7 @@ class Position {
     Coordinates delta,
     Player player,
     PieceType attacker,
-    std::vector<Move>& out
+    MoveList* out
   ) const;
 
   struct Attacks {
@@ -125,7 +268,9 @@ class Position {
     bool operator!=(Attacks other) const;
   };
 
-  struct AttackInfo {
+  // 16 bytes in a row, so arithmetic can be done in a single SIMD
+  // register, if the platform has them.
+  struct alignas(16) AttackInfo {
     Attacks up = {0, 0};
     Attacks up_right = {0, 0};
     Attacks right = {0, 0};
@@ -138,13 +283,19 @@ class Position {
     void SetByDelta(Coordinates delta, Attacks value);
 
     void MultiplyPlayerAttacks(Player player, int8_t factor);
+    void MultiplyPlayerAttacks(int8_t white_factor, int8_t black_factor);
 
     AttackInfo& operator+=(AttackInfo other);
     AttackInfo& operator*=(int8_t other);
     AttackInfo operator-();
   };
+  static_assert(sizeof(AttackInfo) == 16, "AttackInfo must fit a register");
 
   Attacks GetAttacks(Coordinates square) const;
+  template<Player player>
+  int8_t GetAttacksBy(int8_t square) const;
+  // Keeps attack_totals_ up to date.
+  void AddAttacks(int8_t square, Attacks delta);
 
   // Returns AttackInfo for the delayed update.
   AttackInfo UpdateAttacks(
@@ -155,12 +306,7 @@ class Position {
 
   void UpdateKnightAttacks(Coordinates square, Attacks delta);
   void UpdateKingAttacks(Coordinates square, Attacks delta);
-  void UpdatePawnAttacks(
-    Coordinates square,
-    Player player,
-    int8_t file_delta,
-    Attacks delta
-  );
+  void UpdatePawnAttacks(Coordinates square, Player player, Attacks delta);
 
   // Returns AttackInfo for the second wave.
   void UpdateStraightAttacks(
@@ -169,7 +315,6 @@ class Position {
     AttackInfo checking_square_delta
   );
 
-  void UpdateCheckSegment();
   // Add/remove attacks and pins in a given direction.
   // 'attack_delta' says if we should add or remove attacks.
   // 'attacker' is a piece that attacks in a give directions besides the queen.
@@ -180,8 +325,24 @@ class Position {
     Attacks checking_square_delta
   );
 
-  // Do some (not all) legality checks and push the move to leagal_moves_.
-  void PushLegalMove(Move move) const;
+  // SetSquare, but without updating the keys.
+  void UpdateSquare(Coordinates square, Piece piece);
+  // Puts a piece on the board without updating attacks.
+  void PlacePiece(Coordinates square, Piece piece);
+  // Calculates attack maps from scratch, once all pieces are placed.
+  // Faster than placing pieces one by one with SetSquare, as rays are
+  // walked once, without blocking and unblocking the ones already there.
+  void RebuildAttacks();
+  // Adds attacks of a slider, or checking squares of a king, from
+  // the square in the direction of 'delta', up to the first blocker.
+  void RebuildRay(
+    int8_t square,
+    Coordinates delta,
+    Attacks attack,
+    Attacks checking
+  );
+  // Toggles the pieces in all the keys, before the piece is placed.
+  void UpdateKeys(Coordinates square, Piece old_piece, Piece piece);
 
   Player to_move_ = Player::kWhite;
   bool white_castle_kingside_ = true;
@@ -195,18 +356,45 @@ class Position {
 
   Coordinates white_king_ = {-1, -1};
   Coordinates black_king_ = {-1, -1};
-  Segment check_segment_ = {{-1, -1}, {-1, -1}};
 
-  std::array<std::array<Piece, 8>, 8> board_ = {};
+  // Per-square arrays are indexed by square indecies (rank*8 + file).
+  std::array<Piece, 64> board_ = {};
   // Total attacks on a square.
-  std::array<std::array<Attacks, 8>, 8> attacks_ = {};
+  std::array<Attacks, 64> attacks_ = {};
+  // Sums of attacks_, indexed by the underlying value of Player.
+  std::array<int16_t, 3> attack_totals_ = {};
   // For pin calculation.
-  std::array<std::array<AttackInfo, 8>, 8> directed_attacks_ = {};
+  std::array<AttackInfo, 64> directed_attacks_ = {};
   // Where queen, bishops or rooks can check from.
-  std::array<std::array<AttackInfo, 8>, 8> checking_squares_ = {};
+  std::array<AttackInfo, 64> checking_squares_ = {};
+
+  // Same pieces as on the board_, but as sets of squares.
+  // Indexed by the underlying values of PieceType and Player.
+  std::array<Bitboard, 7> piece_bitboards_ = {};
+  std::array<Bitboard, 3> player_bitboards_ = {};
+
+  const ZobristHashFunction* hash_function_ = nullptr;
+  uint64_t key_ = 0;
+  uint64_t pawn_key_ = 0;
+  uint64_t material_key_ = 0;
+};
 
-  mutable bool moves_generated_ = false;
-  mutable std::vector<Move> legal_moves_;
+// Everything needed to take a move back, that can't be deduced
+// from the position after the move. Attack maps aren't saved: unmaking
+// puts the old pieces back with SetSquare, which reverses the attack
+// updates the move made.
+struct Position::UndoInfo {
+  // Squares, the move changed, in the order they were set,
+  // with the pieces they held before.
+  std::array<Coordinates, 4> squares;
+  std::array<Piece, 4> pieces;
+  int8_t size;
+  Coordinates en_pessant;
+  int16_t halfmove_clock;
+  uint8_t castling_rights;  // One bit per player and side.
+  uint64_t key;
+  uint64_t pawn_key;
+  uint64_t material_key;
 };
 
 }  // namespace chess_engine
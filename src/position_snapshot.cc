@@ -0,0 +1,68 @@
+#include "src/position_snapshot.h"
+
+#include <cstdint>
+
+#include "src/bitboard.h"
+#include "src/chess_defines.h"
+#include "src/position.h"
+
+namespace chess_engine {
+
+namespace {
+
+const uint8_t kBlackBit = 8;
+const uint8_t kBlackToMoveFlag = 16;
+
+}  // namespace
+
+PositionSnapshot::PositionSnapshot(const Position& position):
+  flags_(position.GetCastlingRightsBits()),
+  halfmove_clock_(position.GetHalfmoveClock()),
+  move_number_(position.GetMoveNumber())
+{
+  Bitboard occupied = position.GetOccupied();
+  while (occupied) {
+    int8_t index = PopLowestSquare(&occupied);
+    Piece piece = position.GetSquare(IndexToCoordinates(index));
+    uint8_t code = static_cast<uint8_t>(piece.type);
+    if (piece.player == Player::kBlack) {
+      code |= kBlackBit;
+    }
+    board_[index/2] |= code << 4*(index%2);
+  }
+
+  if (position.PlayerToMove() == Player::kBlack) {
+    flags_ |= kBlackToMoveFlag;
+  }
+  Coordinates en_pessant = position.GetEnPessant();
+  if (en_pessant != Coordinates{-1, -1}) {
+    en_pessant_ = SquareIndex(en_pessant);
+  }
+}
+
+Position PositionSnapshot::ToPosition() const {
+  Position ret;
+  for (int8_t index = 0; index < 64; ++index) {
+    uint8_t code = (board_[index/2] >> 4*(index%2)) & 15;
+    if (!code) {
+      continue;
+    }
+    Piece piece = {
+      static_cast<PieceType>(code & ~kBlackBit),
+      code & kBlackBit ? Player::kBlack : Player::kWhite
+    };
+    ret.PlacePiece(IndexToCoordinates(index), piece);
+  }
+  ret.RebuildAttacks();
+
+  ret.to_move_ = flags_ & kBlackToMoveFlag ? Player::kBlack : Player::kWhite;
+  ret.SetCastlingRightsBits(flags_);
+  ret.en_pessant_ = en_pessant_ == -1 ?
+    Coordinates{-1, -1} :
+    IndexToCoordinates(en_pessant_);
+  ret.halfmove_clock_ = halfmove_clock_;
+  ret.move_number_ = move_number_;
+  return ret;
+}
+
+}  // namespace chess_engine
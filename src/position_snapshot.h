@@ -0,0 +1,41 @@
+#ifndef SRC_POSITION_SNAPSHOT_H_
+#define SRC_POSITION_SNAPSHOT_H_
+
+#include <array>
+#include <cstdint>
+
+#include "src/chess_defines.h"
+#include "src/position.h"
+
+namespace chess_engine {
+
+// Compact copy of a Position: the board, whose turn it is, castling
+// rights, en pessant and the clocks, but no attack maps. Meant for
+// storing lots of positions: game history, datasets, caches.
+class PositionSnapshot {
+ public:
+  PositionSnapshot() = default;
+  explicit PositionSnapshot(const Position& position);
+
+  // Rebuilds attack maps from the pieces on the board, in one pass once
+  // all of them are placed.
+  Position ToPosition() const;
+
+  bool operator==(const PositionSnapshot& other) const = default;
+
+ private:
+  // Two squares per byte, square with the index rank*8 + file
+  // is in the byte index/2. Lower half goes to the even squares.
+  // Each half is PieceType, with the fourth bit set for black pieces.
+  std::array<uint8_t, 32> board_ = {};
+  // Bits 0-3 are castling rights, bit 4 is set when black is to move.
+  uint8_t flags_ = 0;
+  // Index of the en pessant square or -1.
+  int8_t en_pessant_ = -1;
+  int16_t halfmove_clock_ = 0;
+  int16_t move_number_ = 0;
+};
+
+}  // namespace chess_engine
+
+#endif  // SRC_POSITION_SNAPSHOT_H_
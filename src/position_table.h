@@ -1,6 +1,7 @@
 #ifndef SRC_POSITION_TABLE_H_
 #define SRC_POSITION_TABLE_H_
 
+#include <algorithm>
 #include <cstdint>
 #include <vector>
 
@@ -23,7 +24,7 @@ class PositionTable {
     elements_[key & mask_] = {key, value};  // Always replace for now.
   }
   void Clear() {
-    elements_ = std::vector<Entry>(1ull << index_size, {0ull, T()});
+    std::fill(elements_.begin(), elements_.end(), Entry{0ull, T()});
   }
  private:
   struct Entry {
@@ -0,0 +1,274 @@
+#include "src/transposition_table.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "src/chess_defines.h"
+
+namespace chess_engine {
+
+namespace {
+
+const size_t kHugePageSize = 2 << 20;
+
+// Entries are shared between threads, but are plain memory, so the table
+// can live in lazily mapped pages. Ordering doesn't matter, the keys are
+// checked anyway.
+uint64_t LoadWord(uint64_t* word) {
+  return std::atomic_ref<uint64_t>(*word).load(std::memory_order_relaxed);
+}
+
+void StoreWord(uint64_t* word, uint64_t value) {
+  std::atomic_ref<uint64_t>(*word).store(value, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+  if (!Resize(megabytes)) {
+    throw std::bad_alloc();
+  }
+}
+
+TranspositionTable::~TranspositionTable() {
+  Free(buckets_, GetBucketCount());
+}
+
+bool TranspositionTable::Resize(size_t megabytes) {
+  // Sizes that don't fit in size_t bytes are clamped, the allocation
+  // fails anyway.
+  size_t bytes = std::min(megabytes, SIZE_MAX >> 20) << 20;
+  size_t bucket_count = 1;
+  while (bucket_count*2 <= bytes/sizeof(Bucket)) {
+    bucket_count *= 2;
+  }
+  Bucket* buckets = Allocate(bucket_count);
+  if (!buckets) {
+    return false;
+  }
+  Free(buckets_, GetBucketCount());
+  buckets_ = buckets;
+  mask_ = bucket_count - 1;
+  generation_ = 0;
+  return true;
+}
+
+size_t TranspositionTable::GetBucketCount() const {
+  return mask_ + 1;
+}
+
+NodeInfo TranspositionTable::Get(uint64_t key) const {
+  Bucket& bucket = buckets_[key & mask_];
+  for (Entry& entry : bucket.entries) {
+    uint64_t data = LoadWord(&entry.data);
+    if (
+      (LoadWord(&entry.key_xor_data) ^ data) == key &&
+      GetDepthOffset(data)
+    ) {
+      return UnpackData(data);
+    }
+  }
+  return NodeInfo();
+}
+
+void TranspositionTable::Set(uint64_t key, NodeInfo value) {
+  Bucket& bucket = buckets_[key & mask_];
+  Entry* replaced = nullptr;
+  for (Entry& entry : bucket.entries) {
+    uint64_t data = LoadWord(&entry.data);
+    if (
+      (LoadWord(&entry.key_xor_data) ^ data) == key &&
+      GetDepthOffset(data)
+    ) {
+      replaced = &entry;
+      // Results without a move still shouldn't lose the old move.
+      if (value.best_move == kNullMove) {
+        value.best_move = UnpackData(data).best_move;
+      }
+      break;
+    }
+  }
+  if (!replaced) {
+    int32_t lowest_value = std::numeric_limits<int32_t>::max();
+    for (Entry& entry : bucket.entries) {
+      int32_t entry_value = GetValue(LoadWord(&entry.data));
+      if (entry_value < lowest_value) {
+        replaced = &entry;
+        lowest_value = entry_value;
+      }
+    }
+  }
+  uint64_t data = PackData(value, generation_);
+  StoreWord(&replaced->key_xor_data, key ^ data);
+  StoreWord(&replaced->data, data);
+}
+
+void TranspositionTable::Prefetch(uint64_t key) const {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(&buckets_[key & mask_]);
+#endif
+}
+
+void TranspositionTable::Clear(int thread_count) {
+  generation_ = 0;
+  size_t bucket_count = GetBucketCount();
+  size_t bytes = bucket_count*sizeof(Bucket);
+#ifdef __linux__
+  // Private anonymous pages read as zeros again, once they are dropped.
+  if (!madvise(buckets_, bytes, MADV_DONTNEED)) {
+    return;
+  }
+#endif
+  // Otherwise every thread zeroes its own part of the table, rounded up
+  // to whole buckets, so the parts cover all of it.
+  char* memory = reinterpret_cast<char*>(buckets_);
+  size_t part = (bucket_count + thread_count - 1) / thread_count;
+  part *= sizeof(Bucket);
+  std::vector<std::thread> threads;
+  for (int i = 1; i < thread_count; ++i) {
+    size_t begin = std::min(bytes, i*part);
+    size_t end = std::min(bytes, begin + part);
+    threads.emplace_back([=]() {
+      std::memset(memory + begin, 0, end - begin);
+    });
+  }
+  std::memset(memory, 0, std::min(bytes, part));
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+void TranspositionTable::NewSearch() {
+  ++generation_;
+}
+
+uint64_t TranspositionTable::PackData(NodeInfo value, uint8_t generation) {
+  assert(value.depth >= -1 && value.depth < 1022);  // Doesn't fit.
+  return
+    static_cast<uint32_t>(value.eval) |
+    static_cast<uint64_t>(value.best_move.GetData()) << 32 |
+    static_cast<uint64_t>(value.depth + 1) << 48 |
+    static_cast<uint64_t>(value.type) << 58 |
+    static_cast<uint64_t>(generation & 15) << 60;
+}
+
+NodeInfo TranspositionTable::UnpackData(uint64_t data) {
+  return {
+    static_cast<int16_t>(GetDepthOffset(data) - 1),
+    static_cast<NodeType>((data >> 58) & 3),
+    static_cast<int32_t>(static_cast<uint32_t>(data)),
+    Move::FromData(static_cast<uint16_t>(data >> 32))
+  };
+}
+
+int16_t TranspositionTable::GetDepthOffset(uint64_t data) {
+  return (data >> 48) & 0x3FF;
+}
+
+int32_t TranspositionTable::GetValue(uint64_t data) const {
+  if (!GetDepthOffset(data)) {
+    return std::numeric_limits<int32_t>::min();  // Empty entries go first.
+  }
+  // Generations are counted modulo 16, so an entry, that survived
+  // 16 searches, looks current again. That only makes the replacement
+  // worse, keys are checked anyway.
+  int32_t age = (generation_ - (data >> 60)) & 15;
+  int32_t ret = GetDepthOffset(data) - 8*age;
+  if (UnpackData(data).type == NodeType::kPV) {
+    ret += 2;
+  }
+  return ret;
+}
+
+TranspositionTable::Bucket* TranspositionTable::Allocate(
+  size_t bucket_count
+) {
+  size_t bytes = bucket_count*sizeof(Bucket);
+#ifdef __linux__
+  // Anonymous mappings start as shared zero pages, so nothing is
+  // committed until the search writes to the table.
+  // Explicit huge pages come first, if the system has some reserved.
+  void* memory = MAP_FAILED;
+  if (bytes % kHugePageSize == 0) {
+    memory = mmap(
+      nullptr,
+      bytes,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+      -1,
+      0
+    );
+  }
+  if (memory == MAP_FAILED && bytes >= kHugePageSize) {
+    // Otherwise transparent huge pages, if they are enabled. They need
+    // the mapping to be aligned, so the extra parts are cut off.
+    size_t padded = bytes + kHugePageSize;
+    void* padded_memory = mmap(
+      nullptr,
+      padded,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1,
+      0
+    );
+    if (padded_memory != MAP_FAILED) {
+      char* begin = static_cast<char*>(padded_memory);
+      size_t head = reinterpret_cast<uintptr_t>(begin) % kHugePageSize;
+      head = head ? kHugePageSize - head : 0;
+      if (head) {
+        munmap(begin, head);
+      }
+      munmap(begin + head + bytes, padded - head - bytes);
+      memory = begin + head;
+      madvise(memory, bytes, MADV_HUGEPAGE);
+    }
+  }
+  if (memory == MAP_FAILED) {
+    memory = mmap(
+      nullptr,
+      bytes,
+      PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS,
+      -1,
+      0
+    );
+  }
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+#else
+  void* memory = ::operator new(
+    bytes, std::align_val_t(sizeof(Bucket)), std::nothrow
+  );
+  if (!memory) {
+    return nullptr;
+  }
+  std::memset(memory, 0, bytes);
+#endif
+  return static_cast<Bucket*>(memory);
+}
+
+void TranspositionTable::Free(Bucket* buckets, size_t bucket_count) {
+  if (!buckets) {
+    return;
+  }
+#ifdef __linux__
+  munmap(buckets, bucket_count*sizeof(Bucket));
+#else
+  ::operator delete(buckets, std::align_val_t(sizeof(Bucket)));
+#endif
+}
+
+}  // namespace chess_engine
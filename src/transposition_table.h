@@ -0,0 +1,102 @@
+#ifndef SRC_TRANSPOSITION_TABLE_H_
+#define SRC_TRANSPOSITION_TABLE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "src/chess_defines.h"
+
+namespace chess_engine {
+
+// Whether the evaluation of the node is exact, or only a bound.
+enum struct NodeType : uint8_t {
+  kFailLow = 0,
+  kPV = 1,
+  kFailHigh = 2
+};
+
+// Result of searching a node.
+struct NodeInfo {
+  int16_t depth = -1;
+  NodeType type;
+  int32_t eval = 0;
+  Move best_move = kNullMove;
+};
+
+// Hash table of search results. Entries are grouped in buckets, that
+// fill one cache line, so every probe reads a single line of memory.
+// When a bucket is full, the least valuable entry is replaced:
+// the one that is shallow, left from older searches and not exact.
+// Large tables are backed by huge pages, when the system has them,
+// so probes don't miss the TLB as often. Where possible, memory is
+// mapped lazily, so pages are only committed when they are first used.
+// Get and Set may be called by several threads at once, without locks.
+// Resize, Clear and NewSearch may not.
+class TranspositionTable {
+ public:
+  // Takes up to 'megabytes' of memory, rounded down to a power of two
+  // number of buckets, but at least one bucket.
+  // Throws std::bad_alloc, if the memory can't be allocated.
+  explicit TranspositionTable(size_t megabytes);
+  ~TranspositionTable();
+  TranspositionTable(const TranspositionTable&) = delete;
+  TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+  // Reallocates the table, all entries are lost. If there is not enough
+  // memory, returns false and keeps the old table with its entries.
+  bool Resize(size_t megabytes);
+  size_t GetBucketCount() const;
+
+  // Returns NodeInfo() if the node is not in the table.
+  NodeInfo Get(uint64_t key) const;
+  void Set(uint64_t key, NodeInfo value);
+  // Starts loading the bucket of the key into the cache, so a Get
+  // or Set shortly after doesn't wait for memory.
+  void Prefetch(uint64_t key) const;
+  // Forgets all the entries. Lazily mapped memory is handed back to the
+  // system, the rest is zeroed by 'thread_count' threads.
+  void Clear(int thread_count = 1);
+  // Entries, stored before the call, are replaced first. Unlike Clear,
+  // takes constant time, so it's enough between searches. Meant to be
+  // called once per search, ages only count the last 16 of them.
+  void NewSearch();
+
+  static const int kBucketSize = 4;
+
+ private:
+  // NodeInfo, packed into 64 bits, and the key, XORed with them.
+  // Both words are written and read atomically, but separately. If two
+  // threads write the entry at once, and the words come from different
+  // writes, the key no longer matches, so the entry is just missed.
+  // All zeros is an empty entry, so fresh zero pages need no filling.
+  struct Entry {
+    uint64_t key_xor_data = 0;
+    // Bits 0-31 hold the eval, bits 32-47 hold the best move, bits 48-57
+    // hold the depth plus one (zero for empty entries), bits 58-59 hold
+    // the node type and bits 60-63 hold the generation.
+    uint64_t data = 0;
+  };
+  struct alignas(64) Bucket {
+    std::array<Entry, kBucketSize> entries;
+  };
+  static_assert(sizeof(Bucket) == 64);
+
+  static uint64_t PackData(NodeInfo value, uint8_t generation);
+  static NodeInfo UnpackData(uint64_t data);
+  static int16_t GetDepthOffset(uint64_t data);
+  // Higher for entries, that are more expensive to recalculate.
+  int32_t GetValue(uint64_t data) const;
+
+  // Memory of the table is zeroed. Returns nullptr on failure.
+  static Bucket* Allocate(size_t bucket_count);
+  static void Free(Bucket* buckets, size_t bucket_count);
+
+  Bucket* buckets_ = nullptr;
+  uint64_t mask_ = 0;
+  uint8_t generation_ = 0;
+};
+
+}  // namespace chess_engine
+
+#endif  // SRC_TRANSPOSITION_TABLE_H_
@@ -68,6 +68,10 @@ void WinboardProtocol::ProcessCommands() {
       tc.seconds_per_period = StringToSeconds(parts[2]);
       tc.increment = std::stoi(parts[3]);
       set_time_callback_(tc);
+    } else if (parts[0] == "memory") {
+      set_memory_callback_(std::stoi(parts[1]));
+    } else if (parts[0] == "cores") {
+      set_cores_callback_(std::stoi(parts[1]));
     }
   }
   
@@ -106,8 +110,8 @@ void WinboardProtocol::DisplayInfo(
 }
 
 void WinboardProtocol::SendFeatures() {
-  std::cout << "feature colors=0 playother=1 setboard=1 usermove=1 done=1"
-            << std::endl;
+  std::cout << "feature colors=0 playother=1 setboard=1 usermove=1 memory=1"
+            << " smp=1 done=1" << std::endl;
 }
 
 double WinboardProtocol::StringToSeconds(const std::string& str) {
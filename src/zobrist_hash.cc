@@ -1,75 +1,15 @@
 #include "src/zobrist_hash.h"
 
 #include <cstdint>
-#include <random>
 
-namespace chess_engine {
-
-ZobristHashFunction::ZobristHashFunction(uint64_t seed) {
-  std::mt19937_64 generator(seed);
-  for (auto &piece_table : white_piece_tables_) {
-    for (auto &file : piece_table) {
-      for (auto &square : file) {
-        square = generator();
-      }
-    }
-  }
-  for (auto &piece_table : black_piece_tables_) {
-    for (auto &file : piece_table) {
-      for (auto &square : file) {
-        square = generator();
-      }
-    }
-  }
-  for (auto &file : en_pessant_) {
-    for (auto &square : file) {
-      square = generator();
-    }
-  }
-  white_castles_kingside_ = generator();
-  white_castles_queenside_ = generator();
-  black_castles_kingside_ = generator();
-  white_castles_queenside_ = generator();;
-  turn_ = generator();
-}
-
-uint64_t ZobristHashFunction::HashPiece(Coordinates square, Piece piece) const {
-  if (piece.player == Player::kWhite) {
-    auto table = white_piece_tables_[static_cast<int8_t>(piece.type)-1];
-    return table[square.file][square.rank];
-  } else if (piece.player == Player::kBlack) {
-    auto table = black_piece_tables_[static_cast<int8_t>(piece.type)-1];
-    return table[square.file][square.rank];
-  } else {
-    return 0ull;  // Empty squares.
-  }
-}
-
-uint64_t ZobristHashFunction::HashEnPessant(Coordinates square) const {
-  if (square == Coordinates{-1, -1}) {
-    return 0ull;
-  }
-  return en_pessant_[square.file][square.rank];
-}
-
-uint64_t ZobristHashFunction::HashCastles(Player player, Castle castle) const {
-  if (player == Player::kWhite) {
-    return castle == Castle::kKingside ?
-           white_castles_kingside_ :
-           white_castles_queenside_;
-  } else {
-    return castle == Castle::kKingside ?
-           black_castles_kingside_ :
-           black_castles_queenside_;
-  }
-}
+#include "src/bitboard.h"
+#include "src/chess_defines.h"
+#include "src/position.h"
 
-uint64_t ZobristHashFunction::HashTurn() const {
-  return turn_;
-}
+namespace chess_engine {
 
 uint64_t ZobristHashFunction::SlowHash(const Position& position) const {
-  uint64_t ret;
+  uint64_t ret = 0;
   for (int8_t file = 0; file < 8; ++file) {
     for (int8_t rank = 0; rank < 8; ++rank) {
       ret ^= HashPiece({file, rank}, position.GetSquare({file, rank}));
@@ -89,49 +29,31 @@ uint64_t ZobristHashFunction::SlowHash(const Position& position) const {
   return ret;
 }
 
-ZobristHash::ZobristHash(
-  const Position& position,
-  const ZobristHashFunction& func
-) : func_(func) {
-  hash_ = func_.SlowHash(position);
-}
-
-ZobristHash::ZobristHash(const ZobristHashFunction& func)
-  : func_(func) {}
-
-ZobristHash::ZobristHash(const ZobristHash& other)
-  : func_(other.func_), hash_(other.hash_) {}
-
-uint64_t ZobristHash::Get() const {
-  return hash_;
-}
-
-ZobristHash::operator uint64_t() const {
-  return hash_;
-}
-
-void ZobristHash::ToggleSquare(Coordinates square, Piece piece) {
-  hash_ ^= func_.HashPiece(square, piece);
-}
-
-void ZobristHash::ToggleEnPessant(Coordinates square) {
-  hash_ ^= func_.HashEnPessant(square);
-}
-
-void ZobristHash::ToggleCastlingRights(Player player, Castle castle) {
-  hash_ ^= func_.HashCastles(player, castle);
-}
-
-void ZobristHash::PassTheTurn() {
-  hash_ ^= func_.HashTurn();
-}
-
-const ZobristHashFunction& ZobristHash::GetHashFunction() const {
-  return func_;
+uint64_t ZobristHashFunction::SlowPawnHash(const Position& position) const {
+  uint64_t ret = 0;
+  for (Player player : {Player::kWhite, Player::kBlack}) {
+    Bitboard pawns = position.GetPieces(PieceType::kPawn, player);
+    while (pawns) {
+      ret ^= HashPiece(PopLowestSquare(&pawns), {PieceType::kPawn, player});
+    }
+  }
+  return ret;
 }
 
-void ZobristHash::RecalculateForPosition(const Position& position) {
-  hash_ = func_.SlowHash(position);
+uint64_t ZobristHashFunction::SlowMaterialHash(
+  const Position& position
+) const {
+  uint64_t ret = 0;
+  for (Player player : {Player::kWhite, Player::kBlack}) {
+    for (int type = 1; type < 7; ++type) {
+      Piece piece = {static_cast<PieceType>(type), player};
+      int8_t count = CountSquares(position.GetPieces(piece.type, player));
+      for (int8_t i = 0; i < count; ++i) {
+        ret ^= HashMaterial(piece, i);
+      }
+    }
+  }
+  return ret;
 }
 
 }  // namespace chess_engine
@@ -4,57 +4,100 @@
 #include <cstdint>
 #include <array>
 
+#include "src/bitboard.h"
 #include "src/chess_defines.h"
 #include "src/position.h"
 
 namespace chess_engine {
 
+namespace internal {
+
+// SplitMix64, small enough to run at compile time, see
+// https://prng.di.unimi.it/splitmix64.c
+constexpr uint64_t NextRandom(uint64_t* state) {
+  uint64_t ret = (*state += 0x9E3779B97F4A7C15ull);
+  ret = (ret ^ (ret >> 30)) * 0xBF58476D1CE4E5B9ull;
+  ret = (ret ^ (ret >> 27)) * 0x94D049BB133111EBull;
+  return ret ^ (ret >> 31);
+}
+
+}  // namespace internal
+
 // Calculate alculating Zobrist hash, for individual pieces/squares,
-// position features, or the entire position. 
+// position features, or the entire position.
+// All keys are generated from the seed, so the function can be
+// created at compile time.
 class ZobristHashFunction {
  public:
-  explicit ZobristHashFunction(uint64_t seed);
-  uint64_t HashPiece(Coordinates square, Piece piece) const;
-  uint64_t HashEnPessant(Coordinates square) const;
-  uint64_t HashCastles(Player player, Castle castle) const;
-  uint64_t HashTurn() const;
+  explicit constexpr ZobristHashFunction(uint64_t seed) {
+    uint64_t state = seed;
+    // Keys for empty squares and colorless pieces stay zero.
+    for (int player = 1; player < 3; ++player) {
+      for (int type = 1; type < 7; ++type) {
+        for (int square = 0; square < 64; ++square) {
+          pieces_[(player*7 + type)*64 + square] =
+            internal::NextRandom(&state);
+        }
+      }
+    }
+    for (uint64_t& key : en_pessant_) {
+      key = internal::NextRandom(&state);
+    }
+    for (uint64_t& key : castles_) {
+      key = internal::NextRandom(&state);
+    }
+    turn_ = internal::NextRandom(&state);
+  }
 
-  // Slow way to hash a position, hash incerementally, when possible
-  uint64_t SlowHash(const Position& position) const;
- private:
-  std::array<std::array<std::array<uint64_t, 8>, 8>, 6> white_piece_tables_;
-  std::array<std::array<std::array<uint64_t, 8>, 8>, 6> black_piece_tables_;
-  std::array<std::array<uint64_t, 8>, 8> en_pessant_;
-  uint64_t white_castles_kingside_;
-  uint64_t white_castles_queenside_;
-  uint64_t black_castles_kingside_;
-  uint64_t black_castles_queenside_;
-  uint64_t turn_;
-};
+  uint64_t HashPiece(int8_t square, Piece piece) const {
+    int player = static_cast<int>(piece.player);
+    int type = static_cast<int>(piece.type);
+    return pieces_[(player*7 + type)*64 + square];
+  }
 
-// Represents zobrist hash of a position, and allows to incrementtally 
-// calculate it.
-class ZobristHash{
- public:
-  explicit ZobristHash(const ZobristHashFunction& func);
-  ZobristHash(const Position& Position, const ZobristHashFunction& func);
-  ZobristHash(const ZobristHash& other);
+  uint64_t HashPiece(Coordinates square, Piece piece) const {
+    return HashPiece(SquareIndex(square), piece);
+  }
+
+  // Key of the 'count'-th piece of the kind, counting from zero.
+  // Material keys are made of these, one for every piece on the board.
+  uint64_t HashMaterial(Piece piece, int8_t count) const {
+    return HashPiece(count, piece);
+  }
+
+  // No square, {-1, -1}, hashes to zero.
+  uint64_t HashEnPessant(Coordinates square) const {
+    return square.file < 0 ? 0ull : en_pessant_[SquareIndex(square)];
+  }
 
-  uint64_t Get() const;
-  operator uint64_t() const;
-  void ToggleSquare(Coordinates square, Piece piece);
-  void ToggleEnPessant(Coordinates square);
-  void ToggleCastlingRights(Player player, Castle castle);
-  void PassTheTurn();
+  uint64_t HashCastles(Player player, Castle castle) const {
+    // Same order as the castling rights bits in Position.
+    int player_index = player == Player::kWhite ? 0 : 1;
+    return castles_[player_index*2 + static_cast<int>(castle)];
+  }
 
-  void RecalculateForPosition(const Position& position);
+  uint64_t HashTurn() const {
+    return turn_;
+  }
+
+  // Slow way to hash a position. Position keeps its key up to date
+  // incerementally, so this is only needed to start from scratch.
+  uint64_t SlowHash(const Position& position) const;
+  uint64_t SlowPawnHash(const Position& position) const;
+  uint64_t SlowMaterialHash(const Position& position) const;
 
-  const ZobristHashFunction& GetHashFunction() const;
  private:
-  const ZobristHashFunction& func_;
-  uint64_t hash_ = 0;
+  // Indexed by [player][piece type][square], using the underlying values
+  // of Player and PieceType.
+  alignas(64) std::array<uint64_t, 3*7*64> pieces_ = {};
+  std::array<uint64_t, 64> en_pessant_ = {};
+  std::array<uint64_t, 4> castles_ = {};
+  uint64_t turn_ = 0;
 };
 
+// Default keys, shared by everything that doesn't need a specific seed.
+inline constexpr ZobristHashFunction kZobristHash(14159265358979323846ull);
+
 }  // namespace chess_engine
 
 #endif  // SRC_ZOBRIST_HASH_H_
@@ -0,0 +1,134 @@
+#include <cstdint>
+#include <random>
+
+#include <catch2/catch_all.hpp>
+
+#include "src/bitboard.h"
+#include "src/chess_defines.h"
+
+chess_engine::Bitboard NaiveSlidingAttacks(
+  int8_t square,
+  chess_engine::Bitboard occupied,
+  bool diagonal
+) {
+  chess_engine::Bitboard ret = 0;
+  for (int8_t file_delta = -1; file_delta <= 1; ++file_delta) {
+    for (int8_t rank_delta = -1; rank_delta <= 1; ++rank_delta) {
+      if (!file_delta && !rank_delta) {
+        continue;
+      }
+      if ((file_delta && rank_delta) != diagonal) {
+        continue;
+      }
+      chess_engine::Coordinates current =
+        chess_engine::IndexToCoordinates(square);
+      current += {file_delta, rank_delta};
+      while (chess_engine::WithinTheBoard(current)) {
+        ret |= chess_engine::SquareBitboard(current);
+        if (occupied & chess_engine::SquareBitboard(current)) {
+          break;
+        }
+        current += {file_delta, rank_delta};
+      }
+    }
+  }
+  return ret;
+}
+
+TEST_CASE("Magic slider attacks match walking the rays", "[bitboard]") {
+  std::mt19937_64 mt(3141592653ull);
+  for (int i = 0; i < 10000; ++i) {
+    int8_t square = mt() % 64;
+    // Sparse boards are closer to the real ones.
+    chess_engine::Bitboard occupied = mt() & mt();
+    REQUIRE(
+      chess_engine::RookAttacks(square, occupied) ==
+      NaiveSlidingAttacks(square, occupied, false)
+    );
+    REQUIRE(
+      chess_engine::BishopAttacks(square, occupied) ==
+      NaiveSlidingAttacks(square, occupied, true)
+    );
+  }
+}
+
+TEST_CASE("Geometry tables match the coordinate math", "[bitboard]") {
+  static_assert(chess_engine::KnightAttacks(0) == 0x20400ull);
+  static_assert(chess_engine::Distance(0, 63) == 7);
+  for (int8_t first = 0; first < 64; ++first) {
+    chess_engine::Coordinates first_coordinates =
+      chess_engine::IndexToCoordinates(first);
+    for (int8_t second = 0; second < 64; ++second) {
+      chess_engine::Coordinates second_coordinates =
+        chess_engine::IndexToCoordinates(second);
+      chess_engine::Bitboard second_bitboard =
+        chess_engine::SquareBitboard(second);
+      REQUIRE(
+        static_cast<bool>(chess_engine::KnightAttacks(first) & second_bitboard)
+        == chess_engine::KnightMoveAway(first_coordinates, second_coordinates)
+      );
+      int8_t distance_squared = chess_engine::DistanceSquared(
+        first_coordinates, second_coordinates
+      );
+      REQUIRE(
+        static_cast<bool>(chess_engine::KingAttacks(first) & second_bitboard)
+        == (distance_squared == 1 || distance_squared == 2)
+      );
+      REQUIRE((chess_engine::Distance(first, second) <= 1) == (
+        distance_squared <= 2
+      ));
+      if (!chess_engine::Line(first, second)) {
+        REQUIRE(!chess_engine::Between(first, second));
+        continue;
+      }
+      for (int8_t point = 0; point < 64; ++point) {
+        chess_engine::Coordinates point_coordinates =
+          chess_engine::IndexToCoordinates(point);
+        chess_engine::Bitboard point_bitboard =
+          chess_engine::SquareBitboard(point);
+        REQUIRE(
+          static_cast<bool>(chess_engine::Line(first, second) & point_bitboard)
+          == chess_engine::BelongsToLine(
+            {first_coordinates, second_coordinates}, point_coordinates
+          )
+        );
+        bool strictly_between =
+          chess_engine::BelongsToSegment(
+            {first_coordinates, second_coordinates}, point_coordinates
+          ) &&
+          point != first && point != second;
+        REQUIRE(
+          static_cast<bool>(
+            chess_engine::Between(first, second) & point_bitboard
+          ) == strictly_between
+        );
+      }
+    }
+  }
+}
+
+TEST_CASE("Steps to the edge stay on the board", "[bitboard]") {
+  for (int8_t square = 0; square < 64; ++square) {
+    for (int8_t file_delta = -1; file_delta <= 1; ++file_delta) {
+      for (int8_t rank_delta = -1; rank_delta <= 1; ++rank_delta) {
+        if (!file_delta && !rank_delta) {
+          continue;
+        }
+        chess_engine::Coordinates delta = {file_delta, rank_delta};
+        chess_engine::Coordinates current =
+          chess_engine::IndexToCoordinates(square);
+        int8_t steps = 0;
+        current += delta;
+        while (chess_engine::WithinTheBoard(current)) {
+          ++steps;
+          REQUIRE(
+            chess_engine::SquareIndex(current) ==
+            square + steps*chess_engine::DirectionOffset(delta)
+          );
+          current += delta;
+        }
+        REQUIRE(chess_engine::SquaresToEdge(square, delta) == steps);
+      }
+    }
+  }
+}
@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <thread>
+
+#include <catch2/catch_all.hpp>
+
+#include "src/chess_defines.h"
+#include "src/engine.h"
+#include "src/fen.h"
+#include "src/node.h"
+#include "src/zobrist_hash.h"
+
+TEST_CASE("Game moves don't pile up undo information", "[engine]") {
+  chess_engine::Engine engine(chess_engine::FenToPosition(
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+  ));
+  engine.MakeMove(chess_engine::UciToMove("e2e4"));
+  engine.MakeMove(chess_engine::UciToMove("d7d5"));
+  engine.MakeMove(chess_engine::UciToMove("e4d5"));
+  REQUIRE(engine.GetRoot().GetUndoDepth() == 0);
+  REQUIRE(engine.GetRoot().GetLastCapture() == chess_engine::Coordinates{3, 4});
+  REQUIRE(
+    engine.GetRoot().GetHash() ==
+    chess_engine::kZobristHash.SlowHash(engine.GetPosition())
+  );
+
+  // Search doesn't leave anything behind either.
+  engine.GetBestMove(3);
+  REQUIRE(engine.GetRoot().GetUndoDepth() == 0);
+}
+
+TEST_CASE("Search with several threads", "[engine]") {
+  chess_engine::Position position = chess_engine::FenToPosition(
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+  );
+  chess_engine::Engine engine(position);
+  engine.SetHashSize(1);
+  engine.SetThreadCount(4);
+  engine.SetBatchSize(1000);
+  engine.SetReportProgressCallback(
+    [](int16_t, int32_t, int64_t, std::list<chess_engine::Move>) {}
+  );
+  int batches = 0;
+  engine.SetProceedWithBatchCallback([&batches]() {
+    return ++batches < 100;
+  });
+  engine.StartSearch();
+  REQUIRE(position.MoveIsLegal(engine.GetBestMove()));
+
+  // Helpers are stopped as well, nobody visits nodes anymore.
+  int64_t nodes = engine.GetNodesVisited();
+  REQUIRE(nodes >= 100*1000);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  REQUIRE(engine.GetNodesVisited() == nodes);
+
+  // Commands, processed in the middle of a search, change the engine
+  // while the helpers would still be running.
+  batches = 0;
+  engine.SetProceedWithBatchCallback([&engine, &batches]() {
+    if (++batches < 50) {
+      return true;
+    }
+    engine.SetThreadCount(2);
+    engine.SetHashSize(2);
+    engine.MakeMove(chess_engine::UciToMove("e5f7"));
+    return false;
+  });
+  engine.StartSearch();
+  position.MakeMove(chess_engine::UciToMove("e5f7"));
+  REQUIRE(
+    chess_engine::PositionToFen(engine.GetPosition()) ==
+    chess_engine::PositionToFen(position)
+  );
+
+  batches = 0;
+  engine.SetProceedWithBatchCallback([&batches]() {
+    return ++batches < 100;
+  });
+  engine.StartSearch();
+  REQUIRE(position.MoveIsLegal(engine.GetBestMove()));
+}
@@ -1,3 +1,4 @@
+#include <string>
 #include <vector>
 
 #include <catch2/catch_all.hpp>
@@ -15,3 +16,17 @@ TEST_CASE("Fen handles piece names correctly", "[fen]") {
     REQUIRE(fen == back_to_fen);
   }
 }
+
+TEST_CASE("Moves survive conversion to xboard notation", "[fen]") {
+  std::vector<std::string> moves{"e2e4", "g8f6", "a7a8q", "h2h1n", "e1g1"};
+  for (const std::string& str : moves) {
+    chess_engine::Move move = chess_engine::XBoardToMove(str);
+    REQUIRE(chess_engine::MoveToXBoard(move) == str);
+    REQUIRE(chess_engine::Move::FromData(move.GetData()) == move);
+  }
+  REQUIRE(
+    chess_engine::XBoardToMove("a7a8q").GetPromotion() ==
+    chess_engine::PieceType::kQueen
+  );
+  REQUIRE(sizeof(chess_engine::Move) == 2u);
+}
@@ -1,5 +1,11 @@
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <vector>
+
 #include <catch2/catch_all.hpp>
 
+#include "src/bitboard.h"
 #include "src/chess_defines.h"
 #include "src/count_moves.h"
 #include "src/fen.h"
@@ -59,3 +65,97 @@ TEST_CASE(
     REQUIRE(chess_engine::CountMovesWithHash(pos, 5, func) == 120413132);
   }
 }
+
+void RequireKeysAreUpdated(
+  chess_engine::Position* position,
+  const chess_engine::ZobristHashFunction& func,
+  int depth
+) {
+  REQUIRE(position->GetKey() == func.SlowHash(*position));
+  REQUIRE(position->GetPawnKey() == func.SlowPawnHash(*position));
+  REQUIRE(position->GetMaterialKey() == func.SlowMaterialHash(*position));
+  if (!depth) {
+    return;
+  }
+  uint64_t key = position->GetKey();
+  std::vector<chess_engine::Move> moves = position->GetLegalMoves();
+  moves.push_back(chess_engine::kNullMove);
+  for (chess_engine::Move move : moves) {
+    if (move == chess_engine::kNullMove && position->IsCheck()) {
+      continue;
+    }
+    uint64_t expected = position->GetKeyAfterMove(move);
+    chess_engine::Position::UndoInfo undo;
+    position->MakeMove(move, &undo);
+    REQUIRE(position->GetKey() == expected);
+    RequireKeysAreUpdated(position, func, depth-1);
+    position->UnmakeMove(undo);
+    REQUIRE(position->GetKey() == key);
+  }
+}
+
+TEST_CASE("Position keeps the key up to date", "[position][hash]") {
+  chess_engine::ZobristHashFunction func(14159265358979323846ull);
+  for (const char* fen : {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+  }) {
+    chess_engine::Position position = chess_engine::FenToPosition(fen);
+    position.SetHashFunction(&func);
+    RequireKeysAreUpdated(&position, func, 3);
+  }
+}
+
+TEST_CASE("Zobrist keys are distinct", "[hash]") {
+  const chess_engine::ZobristHashFunction& func = chess_engine::kZobristHash;
+  std::set<uint64_t> keys;
+  size_t count = 0;
+  for (int8_t square = 0; square < 64; ++square) {
+    REQUIRE(func.HashPiece(square, chess_engine::pieces::kNone) == 0);
+    for (
+      chess_engine::Player player :
+      {chess_engine::Player::kWhite, chess_engine::Player::kBlack}
+    ) {
+      for (int type = 1; type < 7; ++type) {
+        keys.insert(func.HashPiece(
+          square, {static_cast<chess_engine::PieceType>(type), player}
+        ));
+        ++count;
+      }
+    }
+    keys.insert(func.HashEnPessant(chess_engine::IndexToCoordinates(square)));
+    ++count;
+  }
+  keys.insert(func.HashTurn());
+  ++count;
+  REQUIRE(keys.size() == count);
+  REQUIRE(!keys.count(0));
+}
+
+TEST_CASE("Pawn and material keys", "[hash]") {
+  const chess_engine::ZobristHashFunction& func = chess_engine::kZobristHash;
+  auto position_with_keys = [&func](const char* fen) {
+    chess_engine::Position position = chess_engine::FenToPosition(fen);
+    position.SetHashFunction(&func);
+    return position;
+  };
+  chess_engine::Position first = position_with_keys(
+    "r3k3/pp6/8/8/8/8/PP6/4K1NR w - - 0 1"
+  );
+  // Same pawns and material, pieces elsewhere.
+  chess_engine::Position second = position_with_keys(
+    "4k2r/pp6/8/8/3N4/8/PP6/1R2K3 b - - 0 1"
+  );
+  // One more knight instead of the rook.
+  chess_engine::Position third = position_with_keys(
+    "r3k3/pp6/8/8/8/8/PP6/4KNN1 w - - 0 1"
+  );
+  REQUIRE(first.GetKey() != second.GetKey());
+  REQUIRE(first.GetPawnKey() == second.GetPawnKey());
+  REQUIRE(first.GetMaterialKey() == second.GetMaterialKey());
+  REQUIRE(first.GetPawnKey() == third.GetPawnKey());
+  REQUIRE(first.GetMaterialKey() != third.GetMaterialKey());
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "src/chess_defines.h"
+#include "src/fen.h"
+#include "src/move_list.h"
+#include "src/move_picker.h"
+#include "src/position.h"
+#include "test/test_positions.h"
+
+bool Contains(
+  const std::vector<chess_engine::Move>& moves,
+  chess_engine::Move move
+) {
+  return std::find(moves.begin(), moves.end(), move) != moves.end();
+}
+
+// Moves of the previous position are mostly illegal in the current one,
+// just like hash moves after a collision or cut moves from a sibling.
+void RequireStagesAreComplete(
+  chess_engine::Position* position,
+  const std::vector<chess_engine::Move>& previous_moves
+) {
+  std::vector<chess_engine::Move> legal_moves = position->GetLegalMoves();
+  for (chess_engine::Move move : previous_moves) {
+    REQUIRE(position->MoveIsLegal(move) == Contains(legal_moves, move));
+  }
+
+  chess_engine::MoveList staged;
+  position->GenerateCaptures(&staged);
+  position->GenerateQuiets(&staged);
+  REQUIRE(staged.Size() == static_cast<int>(legal_moves.size()));
+  for (const chess_engine::MoveList::Entry& entry : staged) {
+    REQUIRE(Contains(legal_moves, entry.move));
+    REQUIRE(position->MoveIsLegal(entry.move));
+  }
+
+  chess_engine::MoveList pseudo_legal;
+  position->GeneratePseudoLegalCaptures(&pseudo_legal);
+  position->GeneratePseudoLegalQuiets(&pseudo_legal);
+  int legal_count = 0;
+  for (const chess_engine::MoveList::Entry& entry : pseudo_legal) {
+    if (position->IsLegal(entry.move)) {
+      REQUIRE(Contains(legal_moves, entry.move));
+      ++legal_count;
+    }
+  }
+  REQUIRE(legal_count == static_cast<int>(legal_moves.size()));
+
+  chess_engine::Move hash_move =
+    previous_moves.empty() ? chess_engine::kNullMove : previous_moves[0];
+  chess_engine::Move pv_move =
+    legal_moves.empty() ? chess_engine::kNullMove : legal_moves.back();
+  chess_engine::MovePicker picker(
+    *position, hash_move, pv_move, {hash_move, pv_move}
+  );
+  std::vector<chess_engine::Move> picked;
+  chess_engine::Move move;
+  while (picker.GetNextMove(&move)) {
+    REQUIRE(!Contains(picked, move));
+    picked.push_back(move);
+  }
+  REQUIRE(picked.size() == legal_moves.size());
+  if (position->MoveIsLegal(hash_move)) {
+    REQUIRE(picked[0] == hash_move);
+  }
+
+  // The quiescence picker skips captures, that lose material.
+  chess_engine::MoveList captures;
+  position->GenerateCaptures(&captures);
+  int good_captures = 0;
+  for (const chess_engine::MoveList::Entry& entry : captures) {
+    good_captures += position->SeeGE(entry.move, 0);
+  }
+  chess_engine::MovePicker captures_picker(*position);
+  int picked_captures = 0;
+  while (captures_picker.GetNextMove(&move)) {
+    REQUIRE(position->SeeGE(move, 0));
+    ++picked_captures;
+  }
+  REQUIRE(picked_captures == good_captures);
+}
+
+TEST_CASE("Staged generation hands out every legal move once", "[position]") {
+  for (const char* fen : kTestFens) {
+    chess_engine::Position pos = chess_engine::FenToPosition(fen);
+    // Positions are visited depth first, so the previous one is either
+    // the parent, or the last position under a sibling.
+    std::vector<chess_engine::Move> previous_moves;
+    ForEachMoveRecursively(
+      &pos, 2, [&previous_moves](chess_engine::Position* position) {
+        RequireStagesAreComplete(position, previous_moves);
+        previous_moves = position->GetLegalMoves();
+      }
+    );
+  }
+}
+
+void RequireCapturesOnSquaresMatch(chess_engine::Position* position) {
+  chess_engine::MoveList captures;
+  position->GenerateCaptures(&captures);
+  for (int8_t file = 0; file < 8; ++file) {
+    for (int8_t rank = 0; rank < 8; ++rank) {
+      chess_engine::Coordinates square = {file, rank};
+      chess_engine::Piece piece = position->GetSquare(square);
+      if (
+        piece.player != chess_engine::Opponent(position->PlayerToMove()) &&
+        square != position->GetEnPessant()
+      ) {
+        continue;
+      }
+      std::vector<chess_engine::Move> expected;
+      for (const chess_engine::MoveList::Entry& entry : captures) {
+        if (entry.move.GetTo() == square) {
+          expected.push_back(entry.move);
+        }
+      }
+      std::vector<chess_engine::Move> on_square =
+        position->GetCapturesOnSquare(square, position->PlayerToMove());
+      REQUIRE(on_square.size() == expected.size());
+      for (chess_engine::Move move : on_square) {
+        REQUIRE(Contains(expected, move));
+      }
+    }
+  }
+}
+
+TEST_CASE("Captures on a square match all captures", "[position]") {
+  for (const char* fen : kTestFens) {
+    chess_engine::Position pos = chess_engine::FenToPosition(fen);
+    ForEachMoveRecursively(&pos, 2, RequireCapturesOnSquaresMatch);
+  }
+}
@@ -1,7 +1,14 @@
+#include <algorithm>
+#include <vector>
+
 #include <catch2/catch_all.hpp>
 
 #include "src/chess_defines.h"
+#include "src/fen.h"
+#include "src/move_list.h"
 #include "src/position.h"
+#include "src/position_snapshot.h"
+#include "test/test_positions.h"
 
 chess_engine::Position StartingPosition() {
   chess_engine::Position ret;
@@ -54,4 +61,179 @@ TEST_CASE("Make some moves", "[position]") {
 TEST_CASE("Count moves", "[position]") {
   chess_engine::Position pos = StartingPosition();
   REQUIRE(pos.GetLegalMoves().size() == 20u);
+
+  chess_engine::MoveList moves;
+  moves.Push(chess_engine::kNullMove);  // Should be cleared.
+  pos.GetLegalMoves(&moves);
+  REQUIRE(moves.Size() == 20);
+}
+
+void RequireSamePositions(
+  const chess_engine::Position& first,
+  const chess_engine::Position& second
+) {
+  REQUIRE(
+    chess_engine::PositionToFen(first) == chess_engine::PositionToFen(second)
+  );
+  for (auto player : {
+    chess_engine::Player::kWhite, chess_engine::Player::kBlack
+  }) {
+    int16_t total = 0;
+    for (int8_t file = 0; file < 8; ++file) {
+      for (int8_t rank = 0; rank < 8; ++rank) {
+        REQUIRE(
+          first.GetAttacksByPlayer({file, rank}, player) ==
+          second.GetAttacksByPlayer({file, rank}, player)
+        );
+        total += first.GetAttacksByPlayer({file, rank}, player);
+      }
+    }
+    REQUIRE(first.GetTotalAttacks(player) == total);
+    REQUIRE(second.GetTotalAttacks(player) == total);
+  }
+  REQUIRE(first.GetLegalMoves() == second.GetLegalMoves());
+}
+
+TEST_CASE("Unmake move restores the position", "[position]") {
+  // Attack maps are restored by reversing the move, not saved.
+  REQUIRE(sizeof(chess_engine::Position::UndoInfo) <= 80);
+  for (const char* fen : kTestFens) {
+    chess_engine::Position pos = chess_engine::FenToPosition(fen);
+    ForEachMoveRecursively(&pos, 2, [](chess_engine::Position* position) {
+      chess_engine::Position copy = *position;
+      chess_engine::Position::UndoInfo undo;
+      for (chess_engine::Move move : copy.GetLegalMoves()) {
+        position->MakeMove(move, &undo);
+        position->UnmakeMove(undo);
+        RequireSamePositions(*position, copy);
+      }
+    });
+  }
+}
+
+TEST_CASE("Snapshots restore the position", "[position]") {
+  REQUIRE(sizeof(chess_engine::PositionSnapshot) <= 48);
+  for (const char* fen : kTestFens) {
+    chess_engine::Position pos = chess_engine::FenToPosition(fen);
+    ForEachMoveRecursively(&pos, 2, [](chess_engine::Position* position) {
+      chess_engine::PositionSnapshot snapshot(*position);
+      chess_engine::Position restored = snapshot.ToPosition();
+      RequireSamePositions(restored, *position);
+      REQUIRE(chess_engine::PositionSnapshot(restored) == snapshot);
+    });
+  }
+}
+
+// Tries every possible move, legal or not.
+void RequireValidatorIsExact(chess_engine::Position* position) {
+  std::vector<chess_engine::Move> legal_moves = position->GetLegalMoves();
+  for (int8_t from = 0; from < 64; ++from) {
+    for (int8_t to = 0; to < 64; ++to) {
+      for (auto promotion : {
+        chess_engine::PieceType::kNone, chess_engine::PieceType::kQueen,
+        chess_engine::PieceType::kKnight
+      }) {
+        chess_engine::Move move(from, to, promotion);
+        bool in_list = std::find(
+          legal_moves.begin(), legal_moves.end(), move
+        ) != legal_moves.end();
+        REQUIRE(position->MoveIsLegal(move) == in_list);
+      }
+    }
+  }
+}
+
+TEST_CASE("MoveIsLegal accepts exactly the legal moves", "[position]") {
+  std::vector<const char*> fens(kTestFens.begin(), kTestFens.end());
+  // In check, so only evasions are generated.
+  fens.push_back(
+    "r3k2r/p1pp1pb1/bn2Qnp1/2qPN3/1p2P3/2N5/PPPBBPPP/R3K2R b KQkq - 3 2"
+  );
+  fens.push_back("4k3/8/8/1b6/8/3n4/2P5/R3K2R w KQ - 0 1");
+  for (const char* fen : fens) {
+    chess_engine::Position pos = chess_engine::FenToPosition(fen);
+    ForEachMoveRecursively(&pos, 1, RequireValidatorIsExact);
+  }
+}
+
+TEST_CASE("Static exchange evaluation", "[position]") {
+  chess_engine::Position undefended = chess_engine::FenToPosition(
+    "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1"
+  );
+  chess_engine::Move rook_takes_pawn = chess_engine::UciToMove("e1e5");
+  REQUIRE(undefended.StaticExchange(rook_takes_pawn) == 1000);
+  REQUIRE(undefended.SeeGE(rook_takes_pawn, 1000));
+  REQUIRE(!undefended.SeeGE(rook_takes_pawn, 1001));
+
+  chess_engine::Position defended = chess_engine::FenToPosition(
+    "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1"
+  );
+  chess_engine::Move knight_takes_pawn = chess_engine::UciToMove("d3e5");
+  REQUIRE(defended.StaticExchange(knight_takes_pawn) == -2000);
+  REQUIRE(!defended.SeeGE(knight_takes_pawn, 0));
+
+  // The second rook joins in from behind the first one.
+  chess_engine::Position x_ray = chess_engine::FenToPosition(
+    "4k3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1"
+  );
+  chess_engine::Move rook_takes_defended = chess_engine::UciToMove("d2d5");
+  REQUIRE(x_ray.StaticExchange(rook_takes_defended) == 1000);
+  REQUIRE(x_ray.SeeGE(rook_takes_defended, 0));
+}
+
+TEST_CASE("SeeGE agrees with StaticExchange", "[position]") {
+  for (const char* fen : kTestFens) {
+    chess_engine::Position pos = chess_engine::FenToPosition(fen);
+    ForEachMoveRecursively(&pos, 2, [](chess_engine::Position* position) {
+      chess_engine::MoveList captures;
+      position->GenerateCaptures(&captures);
+      for (const chess_engine::MoveList::Entry& entry : captures) {
+        int32_t exchange = position->StaticExchange(entry.move);
+        for (int32_t threshold : {-9000, -2000, -1, 0, 1, 1000, 2000, 9000}) {
+          REQUIRE(
+            position->SeeGE(entry.move, threshold) == (exchange >= threshold)
+          );
+        }
+      }
+    });
+  }
+}
+
+TEST_CASE("GivesCheck matches the position after the move", "[position]") {
+  std::vector<const char*> fens(kTestFens.begin(), kTestFens.end());
+  // Castling checks along the back rank.
+  fens.push_back("5k2/8/8/8/8/8/8/R3K2R w KQ - 0 1");
+  for (const char* fen : fens) {
+    chess_engine::Position pos = chess_engine::FenToPosition(fen);
+    ForEachMoveRecursively(&pos, 2, [](chess_engine::Position* position) {
+      chess_engine::Position::UndoInfo undo;
+      for (chess_engine::Move move : position->GetLegalMoves()) {
+        bool gives_check = position->GivesCheck(move);
+        position->MakeMove(move, &undo);
+        REQUIRE(gives_check == position->IsCheck());
+        position->UnmakeMove(undo);
+      }
+    });
+  }
+}
+
+TEST_CASE("Insufficient material", "[position]") {
+  for (auto fen : {
+    "8/8/4k3/8/8/3K4/8/8 w - - 0 1",
+    "8/8/4k3/8/8/3K4/5N2/8 w - - 0 1",
+    "8/8/4k3/6b1/8/3K4/8/8 b - - 0 1",
+    "8/2b5/4k3/6b1/8/2BK4/8/8 w - - 0 1",
+  }) {
+    REQUIRE(chess_engine::FenToPosition(fen).IsInsufficientMaterial());
+  }
+  for (auto fen : {
+    "8/8/4k3/8/8/3K4/4P3/8 w - - 0 1",
+    "8/8/4k3/8/8/3K4/4NN2/8 w - - 0 1",
+    "8/8/4k3/6b1/8/3K4/5N2/8 w - - 0 1",
+    "8/8/4k3/6b1/8/3K4/2B5/8 w - - 0 1",
+    "8/8/4k3/8/8/3K4/8/7R w - - 0 1",
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  }) {
+    REQUIRE(!chess_engine::FenToPosition(fen).IsInsufficientMaterial());
+  }
 }
@@ -0,0 +1,40 @@
+#ifndef TEST_TEST_POSITIONS_H_
+#define TEST_TEST_POSITIONS_H_
+
+#include <array>
+#include <functional>
+
+#include "src/chess_defines.h"
+#include "src/position.h"
+
+// Well known perft positions: "kiwipete", an endgame with pins along
+// the ranks, a position full of promotions and checks, and one with
+// both sides about to promote.
+inline constexpr std::array<const char*, 4> kTestFens = {
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+  "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"
+};
+
+// Calls 'visitor' for the position and for every position, that can be
+// reached from it in up to 'depth' moves. Moves are made on the position
+// itself, and taken back before the function returns.
+inline void ForEachMoveRecursively(
+  chess_engine::Position* position,
+  int depth,
+  const std::function<void(chess_engine::Position*)>& visitor
+) {
+  visitor(position);
+  if (!depth) {
+    return;
+  }
+  chess_engine::Position::UndoInfo undo;
+  for (chess_engine::Move move : position->GetLegalMoves()) {
+    position->MakeMove(move, &undo);
+    ForEachMoveRecursively(position, depth-1, visitor);
+    position->UnmakeMove(undo);
+  }
+}
+
+#endif  // TEST_TEST_POSITIONS_H_
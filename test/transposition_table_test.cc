@@ -0,0 +1,158 @@
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_all.hpp>
+
+#include "src/chess_defines.h"
+#include "src/fen.h"
+#include "src/transposition_table.h"
+
+// Keys with the same lower bits end up in the same bucket.
+uint64_t KeyInBucket(uint64_t bucket, uint64_t index) {
+  return (index + 1) << 32 | bucket;
+}
+
+TEST_CASE("Transposition table stores search results", "[engine]") {
+  chess_engine::TranspositionTable table(1);
+  chess_engine::Move move = chess_engine::UciToMove("e2e4");
+  uint64_t key = KeyInBucket(3, 0);
+
+  REQUIRE(table.Get(key).depth == -1);
+  table.Set(key, {5, chess_engine::NodeType::kPV, 42, move});
+  chess_engine::NodeInfo info = table.Get(key);
+  REQUIRE(info.depth == 5);
+  REQUIRE(info.type == chess_engine::NodeType::kPV);
+  REQUIRE(info.eval == 42);
+  REQUIRE(info.best_move == move);
+  // Same bucket, but a different position.
+  REQUIRE(table.Get(KeyInBucket(3, 1)).depth == -1);
+
+  // Results without a move keep the old one.
+  table.Set(
+    key, {6, chess_engine::NodeType::kFailLow, 7, chess_engine::kNullMove}
+  );
+  info = table.Get(key);
+  REQUIRE(info.depth == 6);
+  REQUIRE(info.best_move == move);
+
+  table.Clear();
+  REQUIRE(table.Get(key).depth == -1);
+
+  // Same with several threads.
+  table.Set(key, {5, chess_engine::NodeType::kPV, 42, move});
+  uint64_t last_bucket = KeyInBucket(table.GetBucketCount() - 1, 0);
+  table.Set(last_bucket, {2, chess_engine::NodeType::kPV, 1, move});
+  table.Clear(3);
+  REQUIRE(table.Get(key).depth == -1);
+  REQUIRE(table.Get(last_bucket).depth == -1);
+}
+
+TEST_CASE("Deep entries survive a full bucket", "[engine]") {
+  chess_engine::TranspositionTable table(1);
+  uint64_t deep = KeyInBucket(0, 0);
+  table.Set(
+    deep, {10, chess_engine::NodeType::kPV, 1, chess_engine::kNullMove}
+  );
+  for (int i = 1; i < 20; ++i) {
+    table.Set(
+      KeyInBucket(0, i),
+      {0, chess_engine::NodeType::kFailHigh, 0, chess_engine::kNullMove}
+    );
+  }
+  REQUIRE(table.Get(deep).depth == 10);
+  // The last shallow entry is there as well.
+  REQUIRE(table.Get(KeyInBucket(0, 19)).depth == 0);
+
+  // Entries from old searches make room for new ones.
+  for (int i = 0; i < 3; ++i) {
+    table.NewSearch();
+  }
+  const int kBucketSize = chess_engine::TranspositionTable::kBucketSize;
+  for (int i = 20; i < 20 + kBucketSize; ++i) {
+    table.Set(
+      KeyInBucket(0, i),
+      {1, chess_engine::NodeType::kFailHigh, 0, chess_engine::kNullMove}
+    );
+  }
+  REQUIRE(table.Get(deep).depth == -1);
+}
+
+TEST_CASE("Transposition table size is set in megabytes", "[engine]") {
+  chess_engine::TranspositionTable table(1);
+  REQUIRE(table.GetBucketCount() == 16384);
+  uint64_t key = KeyInBucket(16383, 0);
+  table.Set(
+    key, {3, chess_engine::NodeType::kPV, 0, chess_engine::kNullMove}
+  );
+  REQUIRE(table.Get(key).depth == 3);
+
+  // Rounded down to a power of two.
+  table.Resize(3);
+  REQUIRE(table.GetBucketCount() == 32768);
+  REQUIRE(table.Get(key).depth == -1);
+  table.Resize(64);
+  REQUIRE(table.GetBucketCount() == 1048576);
+  table.Set(
+    key, {4, chess_engine::NodeType::kPV, 0, chess_engine::kNullMove}
+  );
+  REQUIRE(table.Get(key).depth == 4);
+}
+
+TEST_CASE("Transposition table is shared between threads", "[engine]") {
+  chess_engine::TranspositionTable table(1);
+  // Few buckets for many keys, so threads keep overwriting each other.
+  const uint64_t kKeys = 4096;
+  auto worker = [&table](uint64_t seed, int* mismatches) {
+    for (uint64_t i = 0; i < 200000; ++i) {
+      uint64_t index = (i*seed + seed) % kKeys;
+      uint64_t key = KeyInBucket(index % 16, index);
+      // Every key has its own eval, so a torn entry would show.
+      chess_engine::NodeInfo info = table.Get(key);
+      if (info.depth != -1 && info.eval != static_cast<int32_t>(index)) {
+        ++*mismatches;
+      }
+      table.Set(key, {
+        static_cast<int16_t>(index % 64),
+        chess_engine::NodeType::kPV,
+        static_cast<int32_t>(index),
+        chess_engine::kNullMove
+      });
+    }
+  };
+  std::vector<int> mismatches(4, 0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back(worker, 2*i + 1, &mismatches[i]);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (int count : mismatches) {
+    REQUIRE(count == 0);
+  }
+}
+
+TEST_CASE("Transposition table survives bad sizes", "[engine]") {
+  chess_engine::TranspositionTable table(1);
+  uint64_t key = KeyInBucket(5, 0);
+  table.Set(
+    key, {3, chess_engine::NodeType::kPV, 0, chess_engine::kNullMove}
+  );
+
+  // Too big to allocate, the old table stays. Negative sizes wrap around
+  // to huge ones.
+  REQUIRE_FALSE(table.Resize(SIZE_MAX >> 20));
+  REQUIRE_FALSE(table.Resize(static_cast<size_t>(-1)));
+  REQUIRE(table.GetBucketCount() == 16384);
+  REQUIRE(table.Get(key).depth == 3);
+
+  // Too small, but there is still one bucket.
+  REQUIRE(table.Resize(0));
+  REQUIRE(table.GetBucketCount() == 1);
+  table.Set(
+    key, {4, chess_engine::NodeType::kPV, 0, chess_engine::kNullMove}
+  );
+  REQUIRE(table.Get(key).depth == 4);
+}